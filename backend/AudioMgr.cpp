@@ -83,5 +83,18 @@ namespace Backend {
 			audioInfo.lfe_low_pass_enable.store(_lfe_low_pass);
 			audioInfo.settings_changed.store(true);
 		}
+
+		void AudioMgr::GetOutputFormat(int& _sampling_rate, int& _channels) const {
+			_sampling_rate = (int)audioInfo.sampling_rate;
+			_channels = (int)audioInfo.channels;
+		}
+
+		audio_stats AudioMgr::GetStats() const {
+			audio_stats stats = {};
+			stats.fill = audioSamples.fill.load(std::memory_order_relaxed);
+			stats.callbacks = audioSamples.callbacks.load(std::memory_order_relaxed);
+			stats.underruns = audioSamples.underruns.load(std::memory_order_relaxed);
+			return stats;
+		}
 	}
 }
\ No newline at end of file
@@ -9,6 +9,8 @@
 #include <map>
 
 namespace Backend {
+	class FrameCapture;
+
 	namespace Audio {
 		/* *************************************************************************************************
 			ENUMS FOR SAMPLING RATE, SPEAKER SETUP (Surround 7.1, ...), USED BUFFER SIZE FOR SDL
@@ -88,6 +90,14 @@ namespace Backend {
 
 			std::condition_variable cond_buffer_update;
 			std::mutex mut_buffer_update;
+
+			FrameCapture* capture = nullptr;			// gets a copy of everything passed to SDL, only changed while the device is locked
+
+			// written by the callback, underruns only count while the audio thread produces samples
+			bool producing = false;						// only changed while the device is locked
+			alignas(64) std::atomic<float> fill = 0.f;
+			alignas(64) std::atomic<u64> callbacks = 0;
+			alignas(64) std::atomic<u64> underruns = 0;
 		};
 
 		/* *************************************************************************************************
@@ -150,6 +160,17 @@ namespace Backend {
 			void SetAudioOutputEnable(const bool& _hf_output, const bool& _lfe_output);
 			void SetFilterEnable(const bool& _dist_low_pass, const bool& _lfe_low_pass);
 
+			/* *************************************************************************************************
+				CAPTURE OF THE AUDIO OUTPUT
+			************************************************************************************************* */
+			virtual void SetFrameCapture(FrameCapture* _capture) = 0;
+			void GetOutputFormat(int& _sampling_rate, int& _channels) const;
+
+			/* *************************************************************************************************
+				RING BUFFER STATS (FILL LEVEL, UNDERRUNS)
+			************************************************************************************************* */
+			audio_stats GetStats() const;
+
 			/* *************************************************************************************************
 				CLONE / ASSIGN PROTECTION
 			************************************************************************************************* */
@@ -6,6 +6,8 @@
 #include "AudioMgr.h"
 #include "logger.h"
 #include "audio_helpers.h"
+#include "FrameCapture.h"
+#include "trace.h"
 #include "SDL_audio.h"
 
 #define _USE_MATH_DEFINES
@@ -135,6 +137,10 @@ namespace Backend {
 			virtAudioInfo = _virt_audio_info;
 			virtAudioInfo.audio_running.store(true);
 
+			SDL_LockAudioDevice(device);
+			audioSamples.producing = true;
+			SDL_UnlockAudioDevice(device);
+
 			audioThread = thread(audio_thread, &audioInfo, &virtAudioInfo, &audioSamples);
 			if (!audioThread.joinable()) {
 				return false;
@@ -150,12 +156,26 @@ namespace Backend {
 			if (audioThread.joinable()) {
 				audioThread.join();
 			}
+
+			SDL_LockAudioDevice(device);
+			audioSamples.producing = false;
+			SDL_UnlockAudioDevice(device);
+
 			for (auto& n : audioSamples.buffer) {
 				n = .0f;
 			}
 			LOG_INFO("[SDL] audio backend stopped");
 		}
 
+		/* *************************************************************************************************
+			CAPTURE: CALLBACK MUST NOT RUN WHILE THE TARGET CHANGES
+		************************************************************************************************* */
+		void AudioSDL::SetFrameCapture(FrameCapture* _capture) {
+			SDL_LockAudioDevice(device);
+			audioSamples.capture = _capture;
+			SDL_UnlockAudioDevice(device);
+		}
+
 		/* *************************************************************************************************
 			DIFFERENT BUFFERS AND ALGORITHMS FOR CREATING DIFFERENT AUDIO EFFECTS
 		************************************************************************************************* */
@@ -346,6 +366,8 @@ namespace Backend {
 				GENERATE NEW SAMPLES REQUESTED BY THE SDL CALLBACK
 			************************************************************************************************* */
 			void process() {
+				TRACE_ZONE("speakers::process");
+
 				if (audio_info->settings_changed.load()) {
 					master_volume = audio_info->master_volume.load();
 					lfe_volume = audio_info->lfe_volume.load();
@@ -482,6 +504,8 @@ namespace Backend {
 			_length: length of this buffer snippet
 		************************************************************************************************* */
 		void audio_callback(void* _user_data, u8* _device_buffer, int _length) {
+			TRACE_ZONE("audio_callback");
+
 			audio_samples* samples = (audio_samples*)_user_data;
 
 			float* reg_2 = samples->buffer.data();
@@ -489,6 +513,15 @@ namespace Backend {
 
 			int b_read_cursor = samples->read_cursor * sizeof(float);
 
+			// the audio thread fills everything up to the read cursor -> equal cursors mean a full ring
+			int ring_size = (int)samples->buffer.size();
+			int queued = samples->write_cursor == samples->read_cursor ? ring_size : (samples->write_cursor - samples->read_cursor + ring_size) % ring_size;
+			samples->fill.store((float)queued / ring_size, std::memory_order_relaxed);
+			samples->callbacks.fetch_add(1, std::memory_order_relaxed);
+			if (samples->producing && queued * (int)sizeof(float) < _length) {
+				samples->underruns.fetch_add(1, std::memory_order_relaxed);
+			}
+
 			int reg_1_size, reg_2_size;
 			if (b_read_cursor + _length > samples->buffer_size) {
 				reg_1_size = samples->buffer_size - b_read_cursor;
@@ -501,6 +534,10 @@ namespace Backend {
 			SDL_memcpy(_device_buffer, reg_1, reg_1_size);
 			SDL_memcpy(_device_buffer + reg_1_size, reg_2, reg_2_size);
 
+			if (samples->capture != nullptr) {
+				samples->capture->PushAudio((const float*)_device_buffer, _length / sizeof(float));
+			}
+
 			memset(reg_1, 0, reg_1_size);
 			memset(reg_2, 0, reg_2_size);
 
@@ -510,6 +547,8 @@ namespace Backend {
 		}
 
 		void audio_thread(audio_information* _audio_info, virtual_audio_information* _virt_audio_info, audio_samples* _samples) {
+			TRACE_THREAD_NAME("audio");
+
 			speakers sp = speakers(
 				_audio_info, _virt_audio_info, _samples
 			);
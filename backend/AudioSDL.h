@@ -18,6 +18,8 @@ namespace Backend {
 			bool StartAudioBackend(virtual_audio_information& _virt_audio_info) override;
 			void StopAudioBackend() override;
 
+			void SetFrameCapture(FrameCapture* _capture) override;
+
 		protected:
 			explicit AudioSDL();
 
@@ -6,9 +6,58 @@
 #include "logger.h"
 #include "helper_functions.h"
 #include <format>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+
+#include "trace.h"
+
+using namespace std::chrono;
 
 namespace Backend {
 	namespace Control {
+		static u64 now_ns() {
+			return (u64)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+		}
+
+		inline const float AXIS_MAX = 32767.f;
+
+		// radial: the stick direction is kept, the remaining range gets stretched to the full range again
+		static void apply_stick_deadzone(const i16& _x, const i16& _y, const float& _deadzone, i16& _out_x, i16& _out_y) {
+			float x = _x / AXIS_MAX;
+			float y = _y / AXIS_MAX;
+			float length = std::sqrt(x * x + y * y);
+			if (length <= _deadzone) {
+				_out_x = 0;
+				_out_y = 0;
+				return;
+			}
+
+			float scale = std::min((length - _deadzone) / (1.f - _deadzone), 1.f) / length;
+			_out_x = (i16)std::clamp(x * scale * AXIS_MAX, -AXIS_MAX - 1.f, AXIS_MAX);
+			_out_y = (i16)std::clamp(y * scale * AXIS_MAX, -AXIS_MAX - 1.f, AXIS_MAX);
+		}
+
+		static i16 apply_trigger_deadzone(const i16& _value, const float& _deadzone) {
+			float value = std::max((int)_value, 0) / AXIS_MAX;
+			if (value <= _deadzone) { return 0; }
+			return (i16)(std::min((value - _deadzone) / (1.f - _deadzone), 1.f) * AXIS_MAX);
+		}
+
+		static bool guid_equal(const SDL_JoystickGUID& _a, const SDL_JoystickGUID& _b) {
+			return SDL_memcmp(_a.data, _b.data, sizeof(_a.data)) == 0;
+		}
+
+		// device indices shift on hot plug, the instance id stays
+		static int device_index_of(const SDL_JoystickID& _instance_id) {
+			for (int i = 0; i < SDL_NumJoysticks(); i++) {
+				if (SDL_JoystickGetDeviceInstanceID(i) == _instance_id) {
+					return i;
+				}
+			}
+			return -1;
+		}
+
 		static std::string guid_to_string(const SDL_JoystickGUID& _guid) {
 			char c_guid[33];
 			SDL_GUIDToString(_guid, c_guid, 33);
@@ -37,10 +86,6 @@ namespace Backend {
 			io.ConfigFlags |= ImGuiConfigFlags_NoMouseCursorChange;
 			io.ConfigFlags &= ~ImGuiConfigFlags_NavEnableGamepad;
 
-			// init controller DB
-			controllerDatabase = _control_settings.controller_db;
-			SDL_GameControllerAddMappingsFromFile(controllerDatabase.c_str());
-
 			SDL_Surface* surface = SDL_LoadBMP(_control_settings.bmp_custom_cursor.c_str());
 			if (surface == nullptr) { LOG_ERROR("[SDL] create cursor surface: ", SDL_GetError()); } else {
 				if (cursor) { SDL_FreeCursor(cursor); }
@@ -49,56 +94,198 @@ namespace Backend {
 					SDL_SetCursor(cursor);
 				}
 			}
+
+			SetAxisFilter(_control_settings.stick_deadzone, _control_settings.trigger_deadzone, _control_settings.axis_event_threshold);
+			SetPlayerCount(_control_settings.players);
+
+			// setting the filter flushes the queue, including the device events of controllers connected at startup
+			SDL_SetEventFilter(EventFilter, this);
+			for (int i = 0; i < SDL_NumJoysticks(); i++) {
+				AddController(i);
+			}
+
+			if (_control_settings.input_poll_rate > 0) {
+				StartInputThread(_control_settings.input_poll_rate);
+			}
+		}
+
+		void ControlMgr::ExitControl() {
+			StopInputRecording();
+			StopInputReplay();
+			StopInputThread();
+			SDL_SetEventFilter(nullptr, nullptr);
+		}
+
+		// file parsing only, may run on another thread during startup
+		void ControlMgr::LoadControllerDatabase(const control_settings& _control_settings) {
+			controllerDatabase = _control_settings.controller_db;
+			if (SDL_GameControllerAddMappingsFromFile(controllerDatabase.c_str()) < 0) {
+				LOG_WARN("[SDL] load controller DB: ", SDL_GetError());
+			}
 		}
 
 		void ControlMgr::ProcessEvents(bool& _running, SDL_Window* _window) {
-			SDL_Event event;
+			if (_window != eventWindow) {
+				eventWindow = _window;
+				eventWindowId = SDL_GetWindowID(_window);
+			}
 
-			while (SDL_PollEvent(&event)) {
-				ImGui_ImplSDL2_ProcessEvent(&event);
-				if (event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_CLOSE && event.window.windowID == SDL_GetWindowID(_window)) {
-					_running = false;
-					return;
-				}
+			eventClockNs = now_ns();
+			eventClockTicks = SDL_GetTicks();
+
+			inputFrame.fetch_add(1, std::memory_order_relaxed);
+			const bool replay = inputRecorder.IsReplaying();
+			if (replay) {
+				ReplayInput();
+			}
 
-				switch (event.type) {
-				case SDL_QUIT:
-					_running = false;
-					break;
-				case SDL_CONTROLLERBUTTONUP:
-				case SDL_CONTROLLERBUTTONDOWN:
-					EnqueueControllerInput(event);
-					break;
-				case SDL_KEYDOWN:
-				case SDL_KEYUP:
-					EnqueueKeyboardInput(event);
-					break;
-				case SDL_MOUSEWHEEL:
-					mouseScroll = event.wheel.y;
-					break;
-				case SDL_CONTROLLERDEVICEADDED:
-					OnGamepadConnect(event.cdevice);
-					break;
-				case SDL_CONTROLLERDEVICEREMOVED:
-					OnGamepadDisconnect(event.cdevice);
-					break;
-				default:
-					break;
+			// focus can only change with events ImGui gets anyway -> evaluated once per call
+			const bool imgui_controller = (io.ConfigFlags & ImGuiConfigFlags_NavEnableGamepad) && ImGui::IsWindowFocused(ImGuiFocusedFlags_AnyWindow);
+
+			SDL_PumpEvents();
+			int event_num;
+			while ((event_num = SDL_PeepEvents(eventBatch.data(), INPUT_EVENT_BATCH_SIZE, SDL_GETEVENT, SDL_FIRSTEVENT, SDL_LASTEVENT)) > 0) {
+				for (int i = 0; i < event_num; i++) {
+					SDL_Event& event = eventBatch[i];
+
+					switch (event.type) {
+					case SDL_CONTROLLERBUTTONUP:
+					case SDL_CONTROLLERBUTTONDOWN:
+					case SDL_CONTROLLERAXISMOTION:
+					case SDL_JOYAXISMOTION:
+					case SDL_JOYBALLMOTION:
+					case SDL_JOYHATMOTION:
+					case SDL_JOYBUTTONDOWN:
+					case SDL_JOYBUTTONUP:
+						if (imgui_controller) {
+							ImGui_ImplSDL2_ProcessEvent(&event);
+						}
+						break;
+					case SDL_MOUSEMOTION:
+						// absolute position, only the last one of a run matters
+						if (i + 1 == event_num || eventBatch[i + 1].type != SDL_MOUSEMOTION) {
+							ImGui_ImplSDL2_ProcessEvent(&event);
+						}
+						break;
+					default:
+						ImGui_ImplSDL2_ProcessEvent(&event);
+						break;
+					}
+
+					switch (event.type) {
+					case SDL_WINDOWEVENT:
+						if (event.window.event == SDL_WINDOWEVENT_CLOSE && event.window.windowID == eventWindowId) {
+							_running = false;
+							return;
+						}
+						break;
+					case SDL_QUIT:
+						_running = false;
+						break;
+					case SDL_CONTROLLERBUTTONUP:
+					case SDL_CONTROLLERBUTTONDOWN:
+						// otherwise the input thread publishes the buttons
+						if (!inputThread.joinable() && !replay) {
+							EnqueueControllerInput(event);
+						}
+						break;
+					case SDL_CONTROLLERAXISMOTION:
+						if (!inputThread.joinable() && !replay) {
+							EnqueueAxisInput(event);
+						}
+						break;
+					case SDL_KEYDOWN:
+					case SDL_KEYUP:
+						if (!replay) {
+							EnqueueKeyboardInput(event);
+						}
+						break;
+					case SDL_MOUSEWHEEL:
+						mouseScroll = event.wheel.y;
+						break;
+					case SDL_CONTROLLERDEVICEADDED:
+						OnGamepadConnect(event.cdevice);
+						break;
+					case SDL_CONTROLLERDEVICEREMOVED:
+						OnGamepadDisconnect(event.cdevice);
+						break;
+					default:
+						break;
+					}
 				}
+
+				if (event_num < INPUT_EVENT_BATCH_SIZE) { break; }
+			}
+			if (event_num < 0) {
+				LOG_WARN("[SDL] peep events: ", SDL_GetError());
 			}
 		}
 
+		// joystick events stay: the game controller layer translates them in an event watcher, which runs after the filter
+		int SDLCALL ControlMgr::EventFilter(void* _user_data, SDL_Event* _event) {
+			const ControlMgr* mgr = (const ControlMgr*)_user_data;
+
+			switch (_event->type) {
+			case SDL_CONTROLLERBUTTONUP:
+			case SDL_CONTROLLERBUTTONDOWN:
+			case SDL_CONTROLLERAXISMOTION:
+				// ignored by ProcessEvents() meanwhile
+				return (mgr->inputThreadRunning.load(std::memory_order_relaxed) || mgr->inputRecorder.IsReplaying()) ? 0 : 1;
+			case SDL_SENSORUPDATE:
+			case SDL_CONTROLLERSENSORUPDATE:
+			case SDL_CONTROLLERTOUCHPADDOWN:
+			case SDL_CONTROLLERTOUCHPADMOTION:
+			case SDL_CONTROLLERTOUCHPADUP:
+				return 0;
+			default:
+				return 1;
+			}
+		}
+
+		// SDL only stamps events in ms -> age of the event relative to the poll, applied to the high resolution clock
+		u64 ControlMgr::EventTimestamp(const SDL_Event& _event) const {
+			u32 age_ms = eventClockTicks - _event.common.timestamp;
+			if (age_ms > eventClockTicks) { return eventClockNs; }		// stamped after the reference was taken (wrapped)
+			return eventClockNs - std::min((u64)age_ms * 1000000, eventClockNs);
+		}
+
+		// warns once per overflow, the queues drop new events until the consumer caught up
+		void ControlMgr::OnInputEnqueued(const bool& _success, bool& _overflow) {
+			if (!_success && !_overflow) {
+				LOG_WARN("[SDL] input queue full, events dropped");
+			}
+			_overflow = !_success;
+		}
+
 		void ControlMgr::EnqueueKeyboardInput(const SDL_Event& _event) {
-			keyQueue.push(std::pair(_event.key.keysym.sym, (SDL_EventType)_event.key.type == SDL_KEYDOWN ? true : false));
+			PushKeyEvent({ EventTimestamp(_event), _event.key.keysym.sym, (SDL_EventType)_event.key.type == SDL_KEYDOWN });
+		}
+
+		void ControlMgr::PushKeyEvent(const key_event& _event) {
+			OnInputEnqueued(keyQueue.push(_event), keyOverflow);
+			inputRecorder.Record({ inputFrame.load(std::memory_order_relaxed), INPUT_RECORD_KEY, _event.pressed, (u32)_event.key, 0 });
+		}
+
+		// -1 if the controller isn't assigned to a player
+		int ControlMgr::GetPlayer(const SDL_JoystickID& _instance_id) const {
+			if (auto it = instancePlayers.find(_instance_id); it != instancePlayers.end()) {
+				return it->second;
+			}
+			return -1;
 		}
 
 		void ControlMgr::EnqueueControllerInput(const SDL_Event& _event) {
-			for (int i = 0; const auto & n : connectedGamepads) {
-				if (_event.cbutton.which == n.instance_id) {
-					//LOG_WARN(std::format("{:d}; {:d}; {:d}", i, _event.cbutton.button, _event.cbutton.state));
-					buttonQueue.push(std::tuple(i, (SDL_GameControllerButton)_event.cbutton.button, _event.cbutton.state == SDL_PRESSED ? true : false));
-					break;
-				}
+			if (int player = GetPlayer(_event.cbutton.which); player >= 0) {
+				u32 mask = 1u << _event.cbutton.button;
+				u32 state = buttonState[player].load(std::memory_order_relaxed);
+				PublishButtonState(player, _event.cbutton.state == SDL_PRESSED ? (state | mask) : (state & ~mask), EventTimestamp(_event));
+			}
+		}
+
+		void ControlMgr::EnqueueAxisInput(const SDL_Event& _event) {
+			if (int player = GetPlayer(_event.caxis.which); player >= 0 && _event.caxis.axis < SDL_CONTROLLER_AXIS_MAX) {
+				axisState[player].raw[_event.caxis.axis] = _event.caxis.value;
+				PublishRawAxes(player, EventTimestamp(_event));
 			}
 		}
 
@@ -108,12 +295,289 @@ namespace Backend {
 			return scroll;
 		}
 
-		std::queue<std::pair<SDL_Keycode, bool>>& ControlMgr::GetKeyQueue() {
-			return keyQueue;
+		bool ControlMgr::PopKeyEvent(key_event& _event) {
+			return keyQueue.pop(_event);
+		}
+
+		bool ControlMgr::PopButtonEvent(button_event& _event) {
+			return buttonQueue.pop(_event);
 		}
 
-		std::queue<std::tuple<int, SDL_GameControllerButton, bool>>& ControlMgr::GetButtonQueue() {
-			return buttonQueue;
+		bool ControlMgr::PopAxisEvent(axis_event& _event) {
+			return axisQueue.pop(_event);
+		}
+
+		u32 ControlMgr::GetButtonState(const int& _player) const {
+			if (_player < 0 || _player >= INPUT_PLAYERS_MAX) { return 0; }
+			return buttonState[_player].load(std::memory_order_acquire);
+		}
+
+		axis_state ControlMgr::GetAxisState(const int& _player) const {
+			axis_state state = {};
+			if (_player < 0 || _player >= INPUT_PLAYERS_MAX) { return state; }
+
+			const player_axes& axes = axisState[_player];
+			u32 begin, end;
+			do {
+				begin = axes.sequence.load(std::memory_order_acquire);
+				state.timestamp_ns = axes.timestamp_ns.load(std::memory_order_relaxed);
+				for (int i = 0; i < SDL_CONTROLLER_AXIS_MAX; i++) {
+					state.values[i] = axes.values[i].load(std::memory_order_relaxed);
+				}
+				std::atomic_thread_fence(std::memory_order_acquire);
+				end = axes.sequence.load(std::memory_order_relaxed);
+			} while ((begin & 1) || begin != end);
+			return state;
+		}
+
+		void ControlMgr::SetAxisFilter(const float& _stick_deadzone, const float& _trigger_deadzone, const int& _event_threshold) {
+			stickDeadzone.store(std::clamp(_stick_deadzone, 0.f, .99f));
+			triggerDeadzone.store(std::clamp(_trigger_deadzone, 0.f, .99f));
+			axisEventThreshold.store(std::max(_event_threshold, 1));
+		}
+
+		bool ControlMgr::SetRumble(const int& _player, const float& _low_frequency, const float& _high_frequency, const u32& _duration_ms) {
+			std::unique_lock<std::mutex> lock_gamepads(mutGamepads);
+			if (_player < 0 || _player >= (int)connectedGamepads.size() || !connectedGamepads[_player].has_controller) { return false; }
+
+			u16 low = (u16)(std::clamp(_low_frequency, 0.f, 1.f) * 0xFFFF);
+			u16 high = (u16)(std::clamp(_high_frequency, 0.f, 1.f) * 0xFFFF);
+			return SDL_GameControllerRumble(connectedGamepads[_player].gamepad, low, high, _duration_ms) == 0;
+		}
+
+		// one event per changed button, all with the same timestamp
+		void ControlMgr::PublishButtonState(const int& _player, const u32& _state, const u64& _timestamp_ns) {
+			u32 changed = buttonState[_player].exchange(_state, std::memory_order_acq_rel) ^ _state;
+			for (int i = 0; changed != 0; i++, changed >>= 1) {
+				if (changed & 1) {
+					button_event event = { _timestamp_ns, _player, (SDL_GameControllerButton)i, (_state & (1u << i)) != 0 };
+					OnInputEnqueued(buttonQueue.push(event), buttonOverflow);
+					inputRecorder.Record({ inputFrame.load(std::memory_order_relaxed), INPUT_RECORD_BUTTON, event.pressed, (u32)i, (u32)_player });
+				}
+			}
+		}
+
+		// deadzones applied to the raw values (producer only)
+		void ControlMgr::PublishRawAxes(const int& _player, const u64& _timestamp_ns) {
+			player_axes& axes = axisState[_player];
+			const float stick_deadzone = stickDeadzone.load(std::memory_order_relaxed);
+			const float trigger_deadzone = triggerDeadzone.load(std::memory_order_relaxed);
+
+			apply_stick_deadzone(axes.raw[SDL_CONTROLLER_AXIS_LEFTX], axes.raw[SDL_CONTROLLER_AXIS_LEFTY], stick_deadzone,
+				axes.current[SDL_CONTROLLER_AXIS_LEFTX], axes.current[SDL_CONTROLLER_AXIS_LEFTY]);
+			apply_stick_deadzone(axes.raw[SDL_CONTROLLER_AXIS_RIGHTX], axes.raw[SDL_CONTROLLER_AXIS_RIGHTY], stick_deadzone,
+				axes.current[SDL_CONTROLLER_AXIS_RIGHTX], axes.current[SDL_CONTROLLER_AXIS_RIGHTY]);
+			axes.current[SDL_CONTROLLER_AXIS_TRIGGERLEFT] = apply_trigger_deadzone(axes.raw[SDL_CONTROLLER_AXIS_TRIGGERLEFT], trigger_deadzone);
+			axes.current[SDL_CONTROLLER_AXIS_TRIGGERRIGHT] = apply_trigger_deadzone(axes.raw[SDL_CONTROLLER_AXIS_TRIGGERRIGHT], trigger_deadzone);
+
+			PublishAxes(_player, _timestamp_ns);
+		}
+
+		// snapshot always gets the current values, events only after moving by the threshold (or reaching rest/the end of the range)
+		void ControlMgr::PublishAxes(const int& _player, const u64& _timestamp_ns) {
+			player_axes& axes = axisState[_player];
+
+			u32 changed = 0;
+			for (int i = 0; i < SDL_CONTROLLER_AXIS_MAX; i++) {
+				if (axes.current[i] != axes.values[i].load(std::memory_order_relaxed)) {
+					changed |= 1u << i;
+				}
+			}
+			if (changed == 0) { return; }
+
+			u32 sequence = axes.sequence.load(std::memory_order_relaxed);
+			axes.sequence.store(sequence + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			axes.timestamp_ns.store(_timestamp_ns, std::memory_order_relaxed);
+			for (int i = 0; i < SDL_CONTROLLER_AXIS_MAX; i++) {
+				axes.values[i].store(axes.current[i], std::memory_order_relaxed);
+			}
+			axes.sequence.store(sequence + 2, std::memory_order_release);
+
+			// every snapshot change gets recorded, the threshold is applied again on replay -> same snapshots and events
+			for (int i = 0; i < SDL_CONTROLLER_AXIS_MAX; i++) {
+				if (changed & (1u << i)) {
+					inputRecorder.Record({ inputFrame.load(std::memory_order_relaxed), INPUT_RECORD_AXIS, false, (u32)i, (u32)_player, axes.current[i] });
+				}
+			}
+
+			const int threshold = axisEventThreshold.load(std::memory_order_relaxed);
+			for (int i = 0; i < SDL_CONTROLLER_AXIS_MAX; i++) {
+				const i16 value = axes.current[i];
+				if (value == axes.published[i]) { continue; }
+
+				bool boundary = value == 0 || value == (i16)AXIS_MAX || value == (i16)(-AXIS_MAX - 1.f);
+				if (!boundary && std::abs(value - axes.published[i]) < threshold) { continue; }
+
+				axes.published[i] = value;
+				OnInputEnqueued(axisQueue.push({ _timestamp_ns, _player, (SDL_GameControllerAxis)i, value }), axisOverflow);
+			}
+		}
+
+		// everything released/centered (replay start/end)
+		void ControlMgr::ResetPlayerInput() {
+			u64 timestamp = now_ns();
+			for (int i = 0; i < INPUT_PLAYERS_MAX; i++) {
+				PublishButtonState(i, 0, timestamp);
+
+				player_axes& axes = axisState[i];
+				std::fill(std::begin(axes.raw), std::end(axes.raw), (i16)0);
+				std::fill(std::begin(axes.current), std::end(axes.current), (i16)0);
+				PublishAxes(i, timestamp);
+			}
+		}
+
+		/* *************************************************************************************************
+			INPUT THREAD: POLLS THE ASSIGNED CONTROLLERS INDEPENDENT OF THE FRAME RATE
+		************************************************************************************************* */
+		void ControlMgr::StartInputThread(const int& _rate) {
+			int rate = std::clamp(_rate, 1, INPUT_POLL_RATE_MAX);
+
+			// the replay is the only producer -> applied by StopInputReplay()
+			if (inputRecorder.IsReplaying()) {
+				inputPollRate = rate;
+				replayResumeInputThread = true;
+				return;
+			}
+
+			StopInputThread();
+
+			inputPollRate = rate;
+			inputThreadRunning.store(true);
+			inputThread = std::thread([this, rate]() -> void { InputThread(rate); });
+			LOG_INFO("[SDL] input thread polling controllers @ ", rate, "Hz");
+		}
+
+		void ControlMgr::StopInputThread() {
+			if (inputRecorder.IsReplaying()) {
+				replayResumeInputThread = false;
+				return;
+			}
+			if (!inputThread.joinable()) { return; }
+
+			inputThreadRunning.store(false);
+			inputThread.join();
+			LOG_INFO("[SDL] input thread stopped");
+		}
+
+		void ControlMgr::InputThread(const int& _rate) {
+			TRACE_THREAD_NAME("input");
+
+			const nanoseconds period = nanoseconds(1000000000 / _rate);
+			steady_clock::time_point next = steady_clock::now();
+
+			while (inputThreadRunning.load()) {
+				PollControllers();
+
+				// absolute deadlines, fell behind by more than a period -> restart from now
+				next += period;
+				steady_clock::time_point now = steady_clock::now();
+				if (now - next > period) {
+					next = now;
+				}
+				std::this_thread::sleep_until(next);
+			}
+		}
+
+		void ControlMgr::PollControllers() {
+			TRACE_ZONE("PollControllers");
+
+			std::unique_lock<std::mutex> lock_gamepads(mutGamepads);
+			SDL_GameControllerUpdate();
+			u64 timestamp = now_ns();
+
+			for (int i = 0; i < (int)connectedGamepads.size() && i < INPUT_PLAYERS_MAX; i++) {
+				const auto& player = connectedGamepads[i];
+				player_axes& axes = axisState[i];
+				u32 state = 0;
+				if (player.has_controller) {
+					for (int j = 0; j < SDL_CONTROLLER_BUTTON_MAX; j++) {
+						if (SDL_GameControllerGetButton(player.gamepad, (SDL_GameControllerButton)j)) {
+							state |= 1u << j;
+						}
+					}
+					for (int j = 0; j < SDL_CONTROLLER_AXIS_MAX; j++) {
+						axes.raw[j] = SDL_GameControllerGetAxis(player.gamepad, (SDL_GameControllerAxis)j);
+					}
+				} else {
+					std::fill(std::begin(axes.raw), std::end(axes.raw), (i16)0);
+				}
+				PublishButtonState(i, state, timestamp);
+				PublishRawAxes(i, timestamp);
+			}
+		}
+
+		/* *************************************************************************************************
+			INPUT RECORDING / REPLAY
+		************************************************************************************************* */
+		bool ControlMgr::StartInputRecording(const std::string& _path) {
+			return inputRecorder.StartRecording(_path, inputFrame.load());
+		}
+
+		void ControlMgr::StopInputRecording() {
+			inputRecorder.StopRecording();
+		}
+
+		// the replay is the only producer meanwhile, held buttons/axes get released on start and end
+		bool ControlMgr::StartInputReplay(const std::string& _path) {
+			if (inputRecorder.IsReplaying()) {
+				StopInputReplay();
+			}
+
+			// stopped before the replay starts, StopInputThread() only defers while replaying
+			const bool resume = inputThread.joinable();
+			StopInputThread();
+			if (!inputRecorder.StartReplay(_path, inputFrame.load())) {
+				if (resume) {
+					StartInputThread(inputPollRate);
+				}
+				return false;
+			}
+			replayResumeInputThread = resume;
+
+			ResetPlayerInput();
+			return true;
+		}
+
+		void ControlMgr::StopInputReplay() {
+			if (!inputRecorder.IsReplaying()) { return; }
+			inputRecorder.StopReplay();
+			ResetPlayerInput();
+
+			if (replayResumeInputThread) {
+				StartInputThread(inputPollRate);
+				replayResumeInputThread = false;
+			}
+		}
+
+		bool ControlMgr::IsInputReplayActive() const {
+			return inputRecorder.IsReplaying();
+		}
+
+		// all records of the current frame, timestamped with the time they got replayed
+		void ControlMgr::ReplayInput() {
+			const u64 frame = inputFrame.load(std::memory_order_relaxed);
+			const u64 timestamp = now_ns();
+
+			input_record record;
+			while (inputRecorder.NextReplayRecord(frame, record)) {
+				if (record.device == INPUT_RECORD_KEY) {
+					PushKeyEvent({ timestamp, (SDL_Keycode)record.code, record.pressed });
+				} else if (record.device == INPUT_RECORD_BUTTON && record.player < INPUT_PLAYERS_MAX && record.code < SDL_CONTROLLER_BUTTON_MAX) {
+					u32 mask = 1u << record.code;
+					u32 state = buttonState[record.player].load(std::memory_order_relaxed);
+					PublishButtonState((int)record.player, record.pressed ? (state | mask) : (state & ~mask), timestamp);
+				} else if (record.device == INPUT_RECORD_AXIS && record.player < INPUT_PLAYERS_MAX && record.code < SDL_CONTROLLER_AXIS_MAX) {
+					// deadzones already applied when recorded, the event threshold gets applied by PublishAxes() like live
+					axisState[record.player].current[record.code] = (i16)record.value;
+					PublishAxes((int)record.player, timestamp);
+				}
+			}
+
+			if (inputRecorder.IsReplayFinished()) {
+				LOG_INFO("[input] replay finished");
+				StopInputReplay();
+			}
 		}
 
 		bool ControlMgr::CheckMouseMove(int& _x, int& _y) {
@@ -158,6 +622,9 @@ namespace Backend {
 		}
 
 		void ControlMgr::AddController(const int& _device_index) {
+			// connected while InitControl() enumerated the controllers -> also reported by an event
+			if (availableGamepads.contains(SDL_JoystickGetDeviceInstanceID(_device_index))) { return; }
+
 			if (SDL_IsGameController(_device_index)) {
 				SDL_GameController* gamepad;
 				SDL_JoystickID instance_id;
@@ -185,18 +652,9 @@ namespace Backend {
 				if (valid) {
 					availableGamepads[instance_id] = { _device_index, name , guid, false };
 
-					bool used = false;
-					int i = 0;
-					for (auto& n : connectedGamepads) {
-						if (!n.has_controller) {
-							SetPlayerController(i, instance_id);
-							used = true;
-							break;
-						}
-						i++;
-					}
-
-					if (!used) {
+					if (int player = FindFreePlayer(guid); player >= 0) {
+						SetPlayerController(player, instance_id);
+					} else {
 						LOG_INFO("[SDL] gamepad added (instance ", instance_id, "; index ", _device_index, "): ", name, " - GUID: {", s_guid, "}");
 					}
 				}
@@ -206,18 +664,10 @@ namespace Backend {
 		void ControlMgr::RemoveController(const Sint32& _instance_id) {
 			if (auto it = availableGamepads.find(_instance_id); it != availableGamepads.end()) {
 
-				int i = 0;
 				bool used = false;
-				if (get<GP_USED>(it->second)) {
-
-					for (auto& n : connectedGamepads) {
-						if (n.has_controller && n.instance_id == _instance_id) {
-							UnsetPlayerController(i);
-							used = true;
-							break;
-						}
-						i++;
-					}
+				if (int player = GetPlayer(_instance_id); player >= 0) {
+					UnsetPlayerController(player);
+					used = true;
 				}
 
 				Sint32 instance_id = it->first;
@@ -231,22 +681,102 @@ namespace Backend {
 
 				if (!used) {
 					LOG_INFO("[SDL] gamepad removed (instance ", instance_id, "; index ", device_index, "): ", name, " - GUID: {", s_guid, "}");
+				} else {
+					// freed slot -> controllers that didn't get one before
+					AssignFreeControllers();
 				}
 			}
 		}
 
+		// free slot that had this controller before, otherwise the first one never used, otherwise any free one (-1: none)
+		int ControlMgr::FindFreePlayer(const SDL_JoystickGUID& _guid) const {
+			int unused = -1;
+			int free = -1;
+			for (int i = 0; i < (int)connectedGamepads.size(); i++) {
+				const auto& player = connectedGamepads[i];
+				if (player.has_controller) { continue; }
+
+				if (player.has_guid && guid_equal(player.guid, _guid)) { return i; }
+				if (!player.has_guid && unused < 0) { unused = i; }
+				if (free < 0) { free = i; }
+			}
+			return unused >= 0 ? unused : free;
+		}
+
+		void ControlMgr::AssignFreeControllers() {
+			for (auto& [instance_id, controller] : availableGamepads) {
+				if (get<GP_USED>(controller)) { continue; }
+
+				int player = FindFreePlayer(get<GP_GUID>(controller));
+				if (player < 0) { break; }
+				SetPlayerController(player, instance_id);
+			}
+		}
+
+		void ControlMgr::SetPlayerCount(const int& _count) {
+			const int count = std::clamp(_count, 1, INPUT_PLAYERS_MAX);
+			for (int i = count; i < (int)connectedGamepads.size(); i++) {
+				if (connectedGamepads[i].has_controller) {
+					UnsetPlayerController(i);
+				}
+			}
+
+			{
+				std::unique_lock<std::mutex> lock_gamepads(mutGamepads);
+				// the input thread stops polling the removed slots -> released here, its polls are serialized by the lock
+				u64 timestamp = now_ns();
+				for (int i = count; i < (int)connectedGamepads.size() && i < INPUT_PLAYERS_MAX; i++) {
+					PublishButtonState(i, 0, timestamp);
+					std::fill(std::begin(axisState[i].raw), std::end(axisState[i].raw), (i16)0);
+					PublishRawAxes(i, timestamp);
+				}
+				connectedGamepads.resize(count);
+			}
+
+			AssignFreeControllers();
+		}
+
+		int ControlMgr::GetPlayerCount() const {
+			return (int)connectedGamepads.size();
+		}
+
 		void ControlMgr::SetPlayerController(const int& _player, const int& _instance_id) {
+			if (_player < 0 || _player >= (int)connectedGamepads.size()) { return; }
+			auto it = availableGamepads.find(_instance_id);
+			if (it == availableGamepads.end()) { return; }
+
 			auto& player = connectedGamepads[_player];
-			auto& controller = availableGamepads[_instance_id];
+			auto& controller = it->second;
 
 			if (player.has_controller) {
 				UnsetPlayerController(_player);
 			}
+			// a controller only drives one player
+			if (int other = GetPlayer(_instance_id); other >= 0) {
+				UnsetPlayerController(other);
+			}
 
-			player.instance_id = _instance_id;
-			player.gamepad = SDL_GameControllerOpen(get<GP_DEVICE_INDEX>(controller));
-			player.has_controller = true;
+			int device_index = device_index_of(_instance_id);
+			if (device_index < 0) {
+				LOG_WARN("[SDL] gamepad (instance ", _instance_id, ") not found");
+				return;
+			}
+			get<GP_DEVICE_INDEX>(controller) = device_index;
 
+			{
+				std::unique_lock<std::mutex> lock_gamepads(mutGamepads);
+				player.instance_id = _instance_id;
+				player.gamepad = SDL_GameControllerOpen(device_index);
+				player.has_controller = player.gamepad != nullptr;
+			}
+			if (!player.has_controller) {
+				LOG_ERROR("[SDL] open gamepad: ", SDL_GetError());
+				return;
+			}
+
+			player.has_guid = true;
+			player.guid = get<GP_GUID>(controller);
+			instancePlayers[_instance_id] = _player;
 			get<GP_USED>(controller) = true;
 
 			std::string s_guid = guid_to_string(get<GP_GUID>(controller));
@@ -255,11 +785,26 @@ namespace Backend {
 		}
 
 		void ControlMgr::UnsetPlayerController(const int& _player) {
+			if (_player < 0 || _player >= (int)connectedGamepads.size() || !connectedGamepads[_player].has_controller) { return; }
+
 			auto& player = connectedGamepads[_player];
 			auto& controller = availableGamepads[player.instance_id];
 
-			SDL_GameControllerClose(player.gamepad);
-			player.has_controller = false;
+			{
+				std::unique_lock<std::mutex> lock_gamepads(mutGamepads);
+				SDL_GameControllerClose(player.gamepad);
+				player.gamepad = nullptr;
+				player.has_controller = false;
+			}
+			instancePlayers.erase(player.instance_id);
+
+			// held buttons/deflected axes get released (the input thread does that on its next poll)
+			if (!inputThread.joinable() && _player < INPUT_PLAYERS_MAX) {
+				u64 timestamp = now_ns();
+				PublishButtonState(_player, 0, timestamp);
+				std::fill(std::begin(axisState[_player].raw), std::end(axisState[_player].raw), (i16)0);
+				PublishRawAxes(_player, timestamp);
+			}
 
 			get<GP_USED>(controller) = false;
 
@@ -1,11 +1,15 @@
 #pragma once
 
 #include "HardwareTypes.h"
+#include "InputRecorder.h"
 
-#include <queue>
 #include <tuple>
 #include <map>
+#include <unordered_map>
 #include <array>
+#include <thread>
+#include <mutex>
+#include <atomic>
 
 #ifndef HWMGR_INCLUDE
 #define HWMGR_INCLUDE
@@ -14,7 +18,39 @@
 #endif
 
 namespace Backend {
+	// timestamps: steady_clock nanoseconds (time_since_epoch) of when SDL received the event
+	struct key_event {
+		u64 timestamp_ns = 0;
+		SDL_Keycode key = SDLK_UNKNOWN;
+		bool pressed = false;
+	};
+
+	struct button_event {
+		u64 timestamp_ns = 0;
+		int player = 0;
+		SDL_GameControllerButton button = SDL_CONTROLLER_BUTTON_INVALID;
+		bool pressed = false;
+	};
+
+	// values after the deadzone got applied, sticks -32768 - 32767, triggers 0 - 32767
+	struct axis_event {
+		u64 timestamp_ns = 0;
+		int player = 0;
+		SDL_GameControllerAxis axis = SDL_CONTROLLER_AXIS_INVALID;
+		i16 value = 0;
+	};
+
+	struct axis_state {
+		u64 timestamp_ns = 0;
+		i16 values[SDL_CONTROLLER_AXIS_MAX] = {};
+	};
+
 	namespace Control {
+		inline const size_t INPUT_QUEUE_SIZE = 256;				// per queue, events beyond that get dropped until the consumer catches up
+		inline const int INPUT_PLAYERS_MAX = 8;
+		inline const int INPUT_POLL_RATE_MAX = 8000;
+		inline const int INPUT_EVENT_BATCH_SIZE = 64;			// SDL events drained per SDL_PeepEvents() call
+
 		enum gamepad_data {
 			GP_DEVICE_INDEX,
 			GP_DEVICE_NAME,
@@ -27,6 +63,22 @@ namespace Backend {
 
 			SDL_JoystickID instance_id = 0;
 			SDL_GameController* gamepad = nullptr;
+
+			// last assigned controller, gets the slot back when reconnected
+			bool has_guid = false;
+			SDL_JoystickGUID guid = {};
+		};
+
+		// latest axis values of a player (own cache line), seqlock: sequence is odd while the producer writes
+		struct alignas(64) player_axes {
+			std::atomic<u32> sequence = 0;
+			std::atomic<u64> timestamp_ns = 0;
+			std::atomic<i16> values[SDL_CONTROLLER_AXIS_MAX] = {};
+
+			// producer only
+			i16 raw[SDL_CONTROLLER_AXIS_MAX] = {};
+			i16 current[SDL_CONTROLLER_AXIS_MAX] = {};
+			i16 published[SDL_CONTROLLER_AXIS_MAX] = {};		// values of the last axis events
 		};
 
 		class ControlMgr {
@@ -36,6 +88,9 @@ namespace Backend {
 			static void resetInstance();
 
 			void InitControl(control_settings& _control_settings);
+			void LoadControllerDatabase(const control_settings& _control_settings);
+			// stops recording/replay/input thread and removes the event filter (flushes the SDL event queue)
+			void ExitControl();
 
 			// clone/assign protection
 			ControlMgr(ControlMgr const&) = delete;
@@ -43,9 +98,38 @@ namespace Backend {
 			ControlMgr& operator=(ControlMgr const&) = delete;
 			ControlMgr& operator=(ControlMgr&&) = delete;
 
+			// drains the SDL queue in batches, controller events only reach ImGui while it navigates with the gamepad
+			// and one of its windows has focus, consecutive mouse motion gets coalesced to the last position
 			void ProcessEvents(bool& _running, SDL_Window* _window);
-			std::queue<std::pair<SDL_Keycode, bool>>& GetKeyQueue();
-			std::queue<std::tuple<int, SDL_GameControllerButton, bool>>& GetButtonQueue();
+
+			// single consumer (e.g. the emulation thread), filled by ProcessEvents() on the main thread
+			bool PopKeyEvent(key_event& _event);
+			bool PopButtonEvent(button_event& _event);
+			bool PopAxisEvent(axis_event& _event);
+
+			// latest pressed buttons of a player (bit per SDL_GameControllerButton) / axis values, can be read from any thread at any time
+			u32 GetButtonState(const int& _player) const;
+			axis_state GetAxisState(const int& _player) const;
+
+			// small stick/trigger movements are dropped, axis events only get queued once the value moved by _event_threshold
+			void SetAxisFilter(const float& _stick_deadzone, const float& _trigger_deadzone, const int& _event_threshold);
+
+			// strength 0 - 1 per motor, false if the controller doesn't support it
+			bool SetRumble(const int& _player, const float& _low_frequency, const float& _high_frequency, const u32& _duration_ms);
+
+			// controllers polled on a dedicated thread at _rate Hz (keyboard state stays with the SDL events,
+			// SDL only updates it on the main thread), the thread then is the only producer of button events,
+			// during a replay both only change whether/at which rate the thread resumes afterwards
+			void StartInputThread(const int& _rate);
+			void StopInputThread();
+
+			// recording of all key/button events per frame (ProcessEvents() call), replay feeds them into the
+			// same queues instead of the devices (input thread paused meanwhile, keyboard/controller events ignored)
+			bool StartInputRecording(const std::string& _path);
+			void StopInputRecording();
+			bool StartInputReplay(const std::string& _path);
+			void StopInputReplay();
+			bool IsInputReplayActive() const;
 			Sint32 GetScroll();
 			bool CheckMouseMove(int& _x, int& _y);
 			void SetMouseVisible(const bool& _visible);
@@ -55,6 +139,10 @@ namespace Backend {
 			void SetPlayerController(const int& _player, const int& _instance_id);
 			void UnsetPlayerController(const int& _player);
 
+			// removed slots lose their controller, added ones get unassigned controllers
+			void SetPlayerCount(const int& _count);
+			int GetPlayerCount() const;
+
 		protected:
 			// constructor
 			explicit ControlMgr() {}
@@ -64,8 +152,38 @@ namespace Backend {
 			static ControlMgr* instance;
 
 			// control
-			std::queue<std::pair<SDL_Keycode, bool>> keyQueue = {};
-			std::queue<std::tuple<int, SDL_GameControllerButton, bool>> buttonQueue = {};
+			spsc_ring<key_event, INPUT_QUEUE_SIZE> keyQueue;
+			spsc_ring<button_event, INPUT_QUEUE_SIZE> buttonQueue;
+			spsc_ring<axis_event, INPUT_QUEUE_SIZE> axisQueue;
+			std::array<std::atomic<u32>, INPUT_PLAYERS_MAX> buttonState = {};		// written by the producer of button events only
+			std::array<player_axes, INPUT_PLAYERS_MAX> axisState = {};				// same producer as the buttons
+			bool keyOverflow = false;											// main thread
+			bool buttonOverflow = false;										// producer of button/axis events
+			bool axisOverflow = false;
+
+			std::atomic<float> stickDeadzone = .15f;
+			std::atomic<float> triggerDeadzone = .05f;
+			std::atomic<int> axisEventThreshold = 512;
+
+			// input thread, mutGamepads guards the opened gamepads against (un)assignment on the main thread
+			std::thread inputThread;
+			alignas(64) std::atomic<bool> inputThreadRunning = false;
+			std::mutex mutGamepads;
+			int inputPollRate = 0;
+			void InputThread(const int& _rate);
+			void PollControllers();
+			void PublishButtonState(const int& _player, const u32& _state, const u64& _timestamp_ns);
+			void PublishRawAxes(const int& _player, const u64& _timestamp_ns);
+			void PublishAxes(const int& _player, const u64& _timestamp_ns);
+			void ResetPlayerInput();
+
+			// recording/replay, the frame counter gets advanced by ProcessEvents()
+			InputRecorder inputRecorder;
+			alignas(64) std::atomic<u64> inputFrame = 0;
+			bool replayResumeInputThread = false;
+			void PushKeyEvent(const key_event& _event);
+			void ReplayInput();
+
 			Sint32 mouseScroll = 0;
 
 			std::string controllerDatabase;
@@ -81,14 +199,32 @@ namespace Backend {
 			void AddController(const int& _device_index);
 			void RemoveController(const Sint32& _instance_id);
 
-			std::vector<controller_data> connectedGamepads = std::vector<controller_data>(1);
+			std::vector<controller_data> connectedGamepads = std::vector<controller_data>(1);		// per player, resized under mutGamepads
+			std::unordered_map<SDL_JoystickID, int> instancePlayers;								// instance id -> player (main thread)
+			int FindFreePlayer(const SDL_JoystickGUID& _guid) const;
+			void AssignFreeControllers();
 
 			std::map<SDL_JoystickID, std::tuple<int, std::string, SDL_JoystickGUID, bool>> availableGamepads;
 
 			SDL_Cursor* cursor = nullptr;
 
+			// SDL event time (ms) -> steady clock, reference taken once per ProcessEvents()
+			u64 eventClockNs = 0;
+			u32 eventClockTicks = 0;
+			u64 EventTimestamp(const SDL_Event& _event) const;
+
+			// runs on whichever thread pushes the event (SDL_PumpEvents(), input thread), drops events before they get queued
+			static int SDLCALL EventFilter(void* _user_data, SDL_Event* _event);
+			std::array<SDL_Event, INPUT_EVENT_BATCH_SIZE> eventBatch = {};
+			SDL_Window* eventWindow = nullptr;
+			u32 eventWindowId = 0;
+
+			void OnInputEnqueued(const bool& _success, bool& _overflow);
+
+			int GetPlayer(const SDL_JoystickID& _instance_id) const;
 			void EnqueueKeyboardInput(const SDL_Event& _event);
 			void EnqueueControllerInput(const SDL_Event& _event);
+			void EnqueueAxisInput(const SDL_Event& _event);
 
 		};
 	}
@@ -0,0 +1,346 @@
+#include "pch.h"
+#include "framework.h"
+
+#include "FrameCapture.h"
+
+#include "logger.h"
+
+#include <cstring>
+#include <algorithm>
+#include <format>
+
+using namespace std::chrono;
+
+namespace Backend {
+	inline const u32 RLE_RUN_BIT = 0x80000000;
+	inline const u32 RLE_MAX_COUNT = 0x7FFFFFFF;
+	inline const size_t RLE_MIN_RUN = 3;
+	inline const u64 WAV_DATA_MAX = 0xFFFFFFFFull - 36;					// RIFF chunk size field is 32 bit
+
+	enum CAPTURE_FRAME_TYPE {
+		FRAME_KEY = 0,
+		FRAME_DELTA = 1
+	};
+
+	template <class T>
+	static void write_value(std::ofstream& _file, const T& _value) {
+		_file.write((const char*)&_value, sizeof(T));
+	}
+
+	// runs of equal pixels (mostly zeroes for delta frames) -> control word + pixel, everything else gets stored as literals
+	static void rle_encode(const std::vector<u32>& _src, std::vector<u32>& _dst) {
+		_dst.clear();
+		const size_t n = _src.size();
+
+		size_t i = 0;
+		while (i < n) {
+			size_t run = 1;
+			while (i + run < n && run < RLE_MAX_COUNT && _src[i + run] == _src[i]) { run++; }
+
+			if (run >= RLE_MIN_RUN) {
+				_dst.push_back(RLE_RUN_BIT | (u32)run);
+				_dst.push_back(_src[i]);
+				i += run;
+				continue;
+			}
+
+			size_t start = i;
+			while (i < n && i - start < RLE_MAX_COUNT) {
+				if (i + RLE_MIN_RUN - 1 < n && _src[i] == _src[i + 1] && _src[i] == _src[i + 2]) { break; }
+				i++;
+			}
+			_dst.push_back((u32)(i - start));
+			_dst.insert(_dst.end(), _src.begin() + start, _src.begin() + i);
+		}
+	}
+
+	FrameCapture::~FrameCapture() {
+		Stop();
+	}
+
+	/* *************************************************************************************************
+		START / STOP
+	************************************************************************************************* */
+	bool FrameCapture::Start(const std::string& _path, const double& _frame_rate, const int& _sampling_rate, const int& _channels) {
+		if (active.load()) {
+			LOG_WARN("[capture] already running");
+			return false;
+		}
+
+		videoFile = std::ofstream(_path + ".cap", std::ios::binary | std::ios::trunc);
+		audioFile = std::ofstream(_path + ".wav", std::ios::binary | std::ios::trunc);
+		rawIndexFile = std::ofstream(_path + ".txt", std::ios::trunc);
+		if (!videoFile.is_open() || !audioFile.is_open() || !rawIndexFile.is_open()) {
+			LOG_ERROR("[capture] open output files ", _path);
+			videoFile.close();
+			audioFile.close();
+			rawIndexFile.close();
+			return false;
+		}
+		basePath = _path;
+		frameRate = _frame_rate;
+
+		const char magic[8] = "BKCAP01";
+		videoFile.write(magic, sizeof(magic));
+		write_value(videoFile, _frame_rate);
+
+		samplingRate = _sampling_rate;
+		channels = std::max(_channels, 1);
+		audioBytes = 0;
+		audioLimitReached = false;
+		WriteWavHeader(0);
+
+		audioRing.assign((size_t)samplingRate * channels * CAPTURE_AUDIO_SECONDS, .0f);
+		audioWrite.store(0);
+		audioRead.store(0);
+		frameWrite.store(0);
+		frameRead.store(0);
+
+		prevPixels.clear();
+		prevWidth = 0;
+		prevHeight = 0;
+		rawSegment = 0;
+		rawWidth = 0;
+		rawHeight = 0;
+		rawFrames = 0;
+
+		framesCaptured.store(0);
+		framesDropped.store(0);
+		framesEncoded.store(0);
+		audioSamplesDropped.store(0);
+		bytesWritten.store(sizeof(magic) + sizeof(_frame_rate));
+
+		startTime = steady_clock::now();
+		active.store(true);
+		encoderThread = std::thread([this]() -> void { EncoderThread(); });
+		if (!encoderThread.joinable()) {
+			LOG_ERROR("[capture] create encoder thread");
+			active.store(false);
+			videoFile.close();
+			audioFile.close();
+			rawIndexFile.close();
+			return false;
+		}
+
+		LOG_INFO("[capture] started: ", _path);
+		return true;
+	}
+
+	// producers have to be detached before (graphics/audio backend), remaining frames and samples get encoded
+	void FrameCapture::Stop() {
+		if (!active.exchange(false)) { return; }
+
+		notifyEncoder.notify_one();
+		if (encoderThread.joinable()) {
+			encoderThread.join();
+		}
+
+		FinishRawSegment();
+		WriteWavHeader((u32)audioBytes);
+		videoFile.close();
+		audioFile.close();
+		rawIndexFile.close();
+
+		LOG_INFO("[capture] stopped: ", framesEncoded.load(), " frames encoded, ", framesDropped.load(), " dropped");
+	}
+
+	bool FrameCapture::IsActive() const {
+		return active.load();
+	}
+
+	/* *************************************************************************************************
+		PRODUCERS: COPY INTO THE RINGS, NEVER WAIT FOR THE ENCODER
+	************************************************************************************************* */
+	void FrameCapture::PushFrame(const u8* _data, const size_t& _size, const u32& _width, const u32& _height) {
+		if (!active.load(std::memory_order_relaxed)) { return; }
+
+		u64 write = frameWrite.load(std::memory_order_relaxed);
+		if (write - frameRead.load(std::memory_order_acquire) >= CAPTURE_FRAME_SLOTS) {
+			framesDropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		frame_slot& slot = frameSlots[write % CAPTURE_FRAME_SLOTS];
+		slot.pixels.resize(_size / sizeof(u32));
+		memcpy(slot.pixels.data(), _data, slot.pixels.size() * sizeof(u32));
+		slot.width = _width;
+		slot.height = _height;
+		slot.timestamp_ns = (u64)duration_cast<nanoseconds>(steady_clock::now() - startTime).count();
+
+		frameWrite.store(write + 1, std::memory_order_release);
+		framesCaptured.fetch_add(1, std::memory_order_relaxed);
+		notifyEncoder.notify_one();
+	}
+
+	void FrameCapture::PushAudio(const float* _samples, const size_t& _count) {
+		if (!active.load(std::memory_order_relaxed)) { return; }
+
+		const size_t size = audioRing.size();
+		u64 write = audioWrite.load(std::memory_order_relaxed);
+		if (size - (size_t)(write - audioRead.load(std::memory_order_acquire)) < _count) {
+			audioSamplesDropped.fetch_add(_count, std::memory_order_relaxed);
+			return;
+		}
+
+		size_t offset = write % size;
+		size_t reg_1_size = std::min(_count, size - offset);
+		memcpy(audioRing.data() + offset, _samples, reg_1_size * sizeof(float));
+		memcpy(audioRing.data(), _samples + reg_1_size, (_count - reg_1_size) * sizeof(float));
+
+		audioWrite.store(write + _count, std::memory_order_release);
+	}
+
+	/* *************************************************************************************************
+		ENCODER
+	************************************************************************************************* */
+	void FrameCapture::EncoderThread() {
+		while (active.load()) {
+			{
+				// timeout: producers notify without holding the mutex
+				std::unique_lock<std::mutex> lock_encoder(mutEncoder);
+				notifyEncoder.wait_for(lock_encoder, milliseconds(10));
+			}
+
+			EncodeFrames();
+			EncodeAudio();
+		}
+
+		EncodeFrames();
+		EncodeAudio();
+	}
+
+	void FrameCapture::EncodeFrames() {
+		u64 read = frameRead.load(std::memory_order_relaxed);
+		const u64 write = frameWrite.load(std::memory_order_acquire);
+
+		for (; read < write; read++) {
+			frame_slot& slot = frameSlots[read % CAPTURE_FRAME_SLOTS];
+
+			bool key = prevPixels.size() != slot.pixels.size() || slot.width != prevWidth || slot.height != prevHeight ||
+				framesEncoded.load(std::memory_order_relaxed) % CAPTURE_KEY_FRAME_INTERVAL == 0;
+
+			if (key) {
+				rle_encode(slot.pixels, encoded);
+			} else {
+				deltaPixels.resize(slot.pixels.size());
+				for (size_t i = 0; i < slot.pixels.size(); i++) {
+					deltaPixels[i] = slot.pixels[i] ^ prevPixels[i];
+				}
+				rle_encode(deltaPixels, encoded);
+			}
+
+			write_value(videoFile, (u32)(key ? FRAME_KEY : FRAME_DELTA));
+			write_value(videoFile, slot.width);
+			write_value(videoFile, slot.height);
+			write_value(videoFile, slot.timestamp_ns);
+			write_value(videoFile, (u32)encoded.size());
+			videoFile.write((const char*)encoded.data(), encoded.size() * sizeof(u32));
+
+			if (!rawFile.is_open() || slot.width != rawWidth || slot.height != rawHeight) {
+				StartRawSegment(slot.width, slot.height);
+			}
+			rawFile.write((const char*)slot.pixels.data(), slot.pixels.size() * sizeof(u32));
+			rawFrames++;
+
+			prevPixels.swap(slot.pixels);
+			prevWidth = slot.width;
+			prevHeight = slot.height;
+
+			// slot is free again after this
+			frameRead.store(read + 1, std::memory_order_release);
+
+			framesEncoded.fetch_add(1, std::memory_order_relaxed);
+			bytesWritten.fetch_add(sizeof(u32) * 4 + sizeof(u64) + (encoded.size() + slot.pixels.size()) * sizeof(u32), std::memory_order_relaxed);
+		}
+
+		if (!videoFile.good() || (rawFile.is_open() && !rawFile.good())) {
+			LOG_ERROR("[capture] write video stream");
+		}
+	}
+
+	// a new file per resolution, raw video has no way to change it midstream
+	void FrameCapture::StartRawSegment(const u32& _width, const u32& _height) {
+		FinishRawSegment();
+
+		rawWidth = _width;
+		rawHeight = _height;
+		rawFrames = 0;
+		rawFile = std::ofstream(std::format("{}_{:d}.rgba", basePath, rawSegment), std::ios::binary | std::ios::trunc);
+		if (!rawFile.is_open()) {
+			LOG_ERROR("[capture] open raw video segment ", rawSegment);
+		}
+	}
+
+	void FrameCapture::FinishRawSegment() {
+		if (!rawFile.is_open()) { return; }
+		rawFile.close();
+
+		const std::string file_name = std::format("{}_{:d}.rgba", basePath, rawSegment);
+		rawIndexFile << std::format("{} {:d}x{:d} {:d} frame(s): ffmpeg -f rawvideo -pixel_format rgba -video_size {:d}x{:d} -framerate {:.4f} -i \"{}\" \"{}_{:d}.mkv\"\n",
+			file_name, rawWidth, rawHeight, rawFrames, rawWidth, rawHeight, frameRate, file_name, basePath, rawSegment);
+		rawIndexFile.flush();
+		rawSegment++;
+	}
+
+	void FrameCapture::EncodeAudio() {
+		const size_t size = audioRing.size();
+		if (size == 0) { return; }
+
+		u64 read = audioRead.load(std::memory_order_relaxed);
+		const u64 write = audioWrite.load(std::memory_order_acquire);
+		size_t count = (size_t)(write - read);
+		if (count == 0) { return; }
+
+		// the WAV header can't describe more, the rest of the capture is video only
+		if (audioLimitReached || audioBytes + count * sizeof(float) > WAV_DATA_MAX) {
+			if (!audioLimitReached) {
+				LOG_WARN("[capture] audio reached the 4 GiB WAV limit, further samples get dropped");
+				audioLimitReached = true;
+			}
+			audioRead.store(write, std::memory_order_release);
+			audioSamplesDropped.fetch_add(count, std::memory_order_relaxed);
+			return;
+		}
+
+		size_t offset = read % size;
+		size_t reg_1_size = std::min(count, size - offset);
+		audioChunk.resize(count);
+		memcpy(audioChunk.data(), audioRing.data() + offset, reg_1_size * sizeof(float));
+		memcpy(audioChunk.data() + reg_1_size, audioRing.data(), (count - reg_1_size) * sizeof(float));
+		audioRead.store(write, std::memory_order_release);
+
+		audioFile.write((const char*)audioChunk.data(), count * sizeof(float));
+		audioBytes += count * sizeof(float);
+		bytesWritten.fetch_add(count * sizeof(float), std::memory_order_relaxed);
+	}
+
+	// RIFF/WAVE with IEEE float samples, sizes get patched on stop
+	void FrameCapture::WriteWavHeader(const u32& _data_size) {
+		audioFile.seekp(0);
+		audioFile.write("RIFF", 4);
+		write_value(audioFile, (u32)(36 + _data_size));
+		audioFile.write("WAVE", 4);
+		audioFile.write("fmt ", 4);
+		write_value(audioFile, (u32)16);
+		write_value(audioFile, (u16)3);										// WAVE_FORMAT_IEEE_FLOAT
+		write_value(audioFile, (u16)channels);
+		write_value(audioFile, (u32)samplingRate);
+		write_value(audioFile, (u32)(samplingRate * channels * sizeof(float)));
+		write_value(audioFile, (u16)(channels * sizeof(float)));
+		write_value(audioFile, (u16)(sizeof(float) * 8));
+		audioFile.write("data", 4);
+		write_value(audioFile, _data_size);
+		audioFile.seekp(0, std::ios::end);
+	}
+
+	capture_stats FrameCapture::GetStats() const {
+		capture_stats stats = {};
+		stats.active = active.load();
+		stats.frames_captured = framesCaptured.load();
+		stats.frames_dropped = framesDropped.load();
+		stats.frames_encoded = framesEncoded.load();
+		stats.audio_samples_dropped = audioSamplesDropped.load();
+		stats.bytes_written = bytesWritten.load();
+		return stats;
+	}
+}
@@ -0,0 +1,116 @@
+#pragma once
+/* ***********************************************************************************************************
+	DESCRIPTION
+*********************************************************************************************************** */
+/*
+*	Lossless capture of the presented 2D frames and the audio output. The render thread and the audio callback
+*	only copy into lock free single producer/single consumer rings and never wait, if the encoder thread falls
+*	behind the frame (or audio chunk) gets dropped and counted.
+*
+*	<path>.cap: header { char magic[8] = "BKCAP01", f64 frame_rate }
+*	            followed by frames { u32 type (0 = key, 1 = delta), u32 width, u32 height, u64 timestamp_ns, u32 words, u32 payload[words] }
+*	            payload: run length encoded RGBA8 pixels (delta frames: XOR against the previous frame),
+*	            control word with the high bit set -> run (next word repeated n times), otherwise n literal words follow
+*	<path>_<n>.rgba: the same frames uncompressed (RGBA8, one file per resolution), playable without custom tooling,
+*	            <path>.txt lists every file with its size, frame count and the matching ffmpeg rawvideo command line
+*	            (constant frame rate, dropped frames are missing, the timestamps of the .cap stream are exact)
+*	<path>.wav: 32 bit float, interleaved with the channel count of the output device, audio stops once the
+*	            data chunk reached the 4 GiB limit of RIFF sizes (dropped samples get counted)
+*/
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+
+#include "defs.h"
+#include "HardwareTypes.h"
+
+namespace Backend {
+	inline const size_t CAPTURE_FRAME_SLOTS = 8;
+	inline const int CAPTURE_AUDIO_SECONDS = 2;
+	inline const u32 CAPTURE_KEY_FRAME_INTERVAL = 300;
+
+	class FrameCapture {
+	public:
+		FrameCapture() = default;
+		~FrameCapture();
+
+		bool Start(const std::string& _path, const double& _frame_rate, const int& _sampling_rate, const int& _channels);
+		void Stop();
+		bool IsActive() const;
+
+		// producers (render thread / audio callback)
+		void PushFrame(const u8* _data, const size_t& _size, const u32& _width, const u32& _height);
+		void PushAudio(const float* _samples, const size_t& _count);
+
+		capture_stats GetStats() const;
+
+	private:
+		struct frame_slot {
+			std::vector<u32> pixels;
+			u32 width = 0;
+			u32 height = 0;
+			u64 timestamp_ns = 0;
+		};
+
+		void EncoderThread();
+		void EncodeFrames();
+		void EncodeAudio();
+		void WriteWavHeader(const u32& _data_size);
+		void StartRawSegment(const u32& _width, const u32& _height);
+		void FinishRawSegment();
+
+		std::ofstream videoFile;
+		std::ofstream audioFile;
+		std::string basePath;
+		double frameRate = .0;
+		std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+		// frame ring, counters only grow (slot = counter % CAPTURE_FRAME_SLOTS)
+		frame_slot frameSlots[CAPTURE_FRAME_SLOTS];
+		alignas(64) std::atomic<u64> frameWrite = 0;
+		alignas(64) std::atomic<u64> frameRead = 0;
+
+		// audio ring
+		std::vector<float> audioRing;
+		alignas(64) std::atomic<u64> audioWrite = 0;
+		alignas(64) std::atomic<u64> audioRead = 0;
+		int samplingRate = 0;
+		int channels = 0;
+		u64 audioBytes = 0;
+		bool audioLimitReached = false;
+
+		// encoder state (encoder thread only)
+		std::vector<u32> prevPixels;
+		std::vector<u32> deltaPixels;
+		std::vector<u32> encoded;
+		std::vector<float> audioChunk;
+		u32 prevWidth = 0;
+		u32 prevHeight = 0;
+
+		// raw segments (encoder thread only)
+		std::ofstream rawFile;
+		std::ofstream rawIndexFile;
+		int rawSegment = 0;
+		u32 rawWidth = 0;
+		u32 rawHeight = 0;
+		u64 rawFrames = 0;
+
+		std::thread encoderThread;
+		std::mutex mutEncoder;
+		std::condition_variable notifyEncoder;
+		alignas(64) std::atomic<bool> active = false;
+
+		// stats
+		alignas(64) std::atomic<u64> framesCaptured = 0;
+		std::atomic<u64> framesDropped = 0;
+		std::atomic<u64> framesEncoded = 0;
+		std::atomic<u64> audioSamplesDropped = 0;
+		std::atomic<u64> bytesWritten = 0;
+	};
+}
@@ -42,6 +42,41 @@ namespace Backend {
 			}
 		}
 
+		bool GraphicsMgr::GetShaderCompilationProgress(int& _compiled, int& _total) const {
+			_compiled = shadersCompiled;
+			_total = shadersTotal;
+			return shaderCompilationFinished;
+		}
+
+		std::chrono::nanoseconds GraphicsMgr::GetFrameStartDelay() const {
+			return std::chrono::nanoseconds(frameStartDelayNs.load());
+		}
+
+		void GraphicsMgr::MarkInputSampled() {
+			inputSampleTime = std::chrono::steady_clock::now();
+		}
+
+		void GraphicsMgr::SetFrameCapture(FrameCapture* _capture) {
+			frameCapture = _capture;
+		}
+
+		// CPU only (TTF rasterization into the atlas), can run next to the device init, has to be done before InitImgui
+		void GraphicsMgr::LoadFonts() {
+			ImGuiIO& io = ImGui::GetIO();
+			const char* font = fontMain.c_str();
+			if (fonts.size() == 0) { fonts.emplace_back(); }
+
+			io.Fonts->AddFontDefault();
+			fonts[0] = io.Fonts->AddFontFromFileTTF(font, 13.f, NULL, io.Fonts->GetGlyphRangesDefault());
+			IM_ASSERT(fonts[0] != nullptr);
+
+			io.Fonts->Build();
+		}
+
+		void GraphicsMgr::SetJobSystem(JobSystem* _jobs) {
+			jobSystem = _jobs;
+		}
+
 		ImFont* GraphicsMgr::GetFont(const int& _index) {
 			if (fonts.size() > (size_t)_index) { 
 				return fonts[_index]; 
@@ -2,6 +2,7 @@
 
 #include <string>
 #include <atomic>
+#include <chrono>
 
 #include "HardwareTypes.h"
 
@@ -12,6 +13,9 @@
 #endif
 
 namespace Backend {
+	class FrameCapture;
+	class JobSystem;
+
 	namespace Graphics {
 #ifndef GRAPHICS_DEBUG
 		//#define GRAPHICS_DEBUG
@@ -48,6 +52,7 @@ namespace Backend {
 		};
 
 #define TEX2D_CHANNELS			    4
+#define TEX2D_LAYERS_MAX			4
 
 		class GraphicsMgr {
 
@@ -70,6 +75,7 @@ namespace Backend {
 			// shader compilation
 			virtual void EnumerateShaders() = 0;
 			virtual void CompileNextShader() = 0;
+			bool GetShaderCompilationProgress(int& _compiled, int& _total) const;
 
 			// imgui
 			virtual bool InitImgui() = 0;
@@ -84,6 +90,29 @@ namespace Backend {
 			virtual void SetSwapchainSettings(bool& _present_mode_fifo, bool& _triple_buffering) = 0;
 
 			ImFont* GetFont(const int& _index);
+			void LoadFonts();
+
+			virtual graphics_memory_stats GetMemoryStats() = 0;
+
+			virtual gpu_timings GetGpuTimings() = 0;
+
+			// low latency
+			virtual void SetLowLatencyMode(const bool& _enable, const bool& _single_frame_in_flight) = 0;
+			virtual latency_stats GetLatencyStats() = 0;
+			std::chrono::nanoseconds GetFrameStartDelay() const;
+			void MarkInputSampled();
+
+			// headless only: copy of the most recent finished frame (RGBA8, tightly packed)
+			virtual bool ReadbackFrame(std::vector<u8>& _data, u32& _width, u32& _height) = 0;
+
+			// compute post processing of the 2d output, empty -> texture gets presented directly
+			virtual void SetUpscaleChain(const std::vector<upscale_pass>& _passes) = 0;
+
+			// capture: every uploaded tex2d frame gets copied to the capture (nullptr to detach)
+			void SetFrameCapture(FrameCapture* _capture);
+
+			// shader compilation runs as jobs, without job system on the calling thread
+			void SetJobSystem(JobSystem* _jobs);
 
 		protected:
 
@@ -94,6 +123,9 @@ namespace Backend {
 				vPatch = _settings.v_patch;
 				fontMain = _settings.font;
 				shaderFolder = _settings.shader_folder;
+				headless = _settings.headless;
+				lowLatency = _settings.lowLatency;
+				singleFrameInFlight = _settings.singleFrameInFlight;
 			}
 			~GraphicsMgr() = default;
 
@@ -104,6 +136,7 @@ namespace Backend {
 
 			// sdl
 			SDL_Window* window = nullptr;
+			bool headless = false;
 			virtual void RecalcTex2dScaleMatrix() = 0;
 			float aspectRatio = 1.f;
 
@@ -135,6 +168,15 @@ namespace Backend {
 
 			std::vector<ImFont*> fonts;
 
+			// low latency
+			bool lowLatency = false;
+			bool singleFrameInFlight = false;
+			std::chrono::steady_clock::time_point inputSampleTime = std::chrono::steady_clock::now();
+			alignas(64) std::atomic<i64> frameStartDelayNs = 0;
+
+			FrameCapture* frameCapture = nullptr;
+			JobSystem* jobSystem = nullptr;
+
 		private:
 			static GraphicsMgr* instance;
 		};
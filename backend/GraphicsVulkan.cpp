@@ -6,17 +6,31 @@
 #include "logger.h"
 #include "helper_functions.h"
 #include "data_io.h"
+#include "FrameCapture.h"
+#include "upscale_shaders.h"
+#include "layer_shaders.h"
+#include "trace.h"
 
 #include <unordered_map>
 #include <format>
 #include <iostream>
+#include <filesystem>
+#include <algorithm>
 
 using namespace std;
+using namespace std::chrono;
 
 #ifdef GRAPHICS_DEBUG
 #define VK_VALIDATION "VK_LAYER_KHRONOS_validation"
 #endif
 
+// shaderc gets linked from the Vulkan SDK, its version (set by the project from $(VULKAN_SDK)) is part of the shader cache key
+#ifndef SHADER_COMPILER_VERSION
+#define SHADER_COMPILER_VERSION unknown
+#endif
+#define SHADER_STRINGIFY_INNER(_x) #_x
+#define SHADER_STRINGIFY(_x) SHADER_STRINGIFY_INNER(_x)
+
 namespace Backend {
 	namespace Graphics {
 #ifdef GRAPHICS_DEBUG
@@ -33,6 +47,7 @@ namespace Backend {
 		#define FRAG_EXT		"frag"
 		#define COMP_EXT		"comp"
 		#define SPIRV_EXT		"spv"
+		const u32 SPIRV_MAGIC = 0x07230203;
 
 		const unordered_map<string, shaderc_shader_kind> SHADER_TYPES = {
 			{VERT_EXT, shaderc_glsl_vertex_shader},
@@ -200,13 +215,23 @@ namespace Backend {
 				0x16, 0x00, 0x00, 0x00, 0xfd, 0x00, 0x01, 0x00, 0x38, 0x00, 0x01, 0x00
 		};
 
-		bool compile_shader(vector<char>& _byte_code, const string& _shader_source_file, const shaderc_compiler_t& _compiler, const shaderc_compile_options_t& _options, const std::string& _shader_cache);
+		bool compile_shader(vector<char>& _byte_code, const string& _shader_source_file, const shaderc_compiler_t& _compiler, const shaderc_compile_options_t& _options, const std::string& _shader_cache, const u64& _cache_key);
+		bool compile_shader_source(vector<char>& _byte_code, const vector<char>& _source, const string& _file_name, const shaderc_compiler_t& _compiler, const shaderc_compile_options_t& _options, const std::string& _shader_cache, const u64& _cache_key);
+		u64 init_compile_options(shaderc_compile_options_t& _options);
+		VkPipelineStageFlags legacy_stage(const VkPipelineStageFlags2KHR& _stage, const VkPipelineStageFlags& _none);
+		VkAccessFlags legacy_access(const VkAccessFlags2KHR& _access);
 		#ifdef VK_DEBUG_CALLBACK
 		VkBool32 VKAPI_CALL debug_report_callback(VkDebugUtilsMessageSeverityFlagBitsEXT _severity, VkDebugUtilsMessageTypeFlagsEXT messageTypes, const VkDebugUtilsMessengerCallbackDataEXT* _callback_data, void* userData);
 		#endif
 
 		GraphicsVulkan::GraphicsVulkan(SDL_Window** _window, const graphics_settings& _settings) : GraphicsMgr(_settings) {
-			auto window_flags = (SDL_WindowFlags)(SDL_WINDOW_VULKAN | SDL_WINDOW_RESIZABLE | SDL_WINDOW_ALLOW_HIGHDPI);
+			// headless: the window only serves imgui input/size, nothing gets presented to it
+			auto window_flags = headless ? SDL_WINDOW_HIDDEN : (SDL_WindowFlags)(SDL_WINDOW_VULKAN | SDL_WINDOW_RESIZABLE | SDL_WINDOW_ALLOW_HIGHDPI);
+			if (headless) {
+				win_width = _settings.win_width;
+				win_height = _settings.win_height;
+			}
+			framesInFlight = (lowLatency && singleFrameInFlight) ? 1 : FRAMES_IN_FLIGHT;
 			*_window = SDL_CreateWindow(_settings.app_title.c_str(), SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, _settings.win_width, _settings.win_height, window_flags);
 			window = *_window;
 
@@ -225,15 +250,23 @@ namespace Backend {
 			};
 		#endif
 
-			uint32_t sdl_extension_count;
-			SDL_Vulkan_GetInstanceExtensions(window, &sdl_extension_count, nullptr);
+			// headless runs without any surface/swapchain extensions (e.g. software ICDs like lavapipe)
+			uint32_t sdl_extension_count = 0;
+			if (!headless) {
+				SDL_Vulkan_GetInstanceExtensions(window, &sdl_extension_count, nullptr);
+			}
 			auto sdl_extensions = vector<const char*>(sdl_extension_count);
-			SDL_Vulkan_GetInstanceExtensions(window, &sdl_extension_count, sdl_extensions.data());
+			if (!headless) {
+				SDL_Vulkan_GetInstanceExtensions(window, &sdl_extension_count, sdl_extensions.data());
+			}
 		#ifdef VK_DEBUG_CALLBACK
 			sdl_extensions.insert(sdl_extensions.end(), additional_extensions.begin(), additional_extensions.end());
 		#endif
 
-			vector<const char*> device_extensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+			vector<const char*> device_extensions = {};
+			if (!headless) {
+				device_extensions.emplace_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+			}
 
 			if (!InitVulkanInstance(sdl_extensions)) {
 				return false;
@@ -251,6 +284,10 @@ namespace Backend {
 		bool GraphicsVulkan::ExitGraphics() {
 			WaitIdle();
 
+			graphics_memory_stats stats = allocator.GetStats();
+			LOG_INFO("[vulkan] allocator: ", stats.device_allocations, " memory block(s), ", stats.allocations, " allocation(s) left");
+			allocator.Destroy();
+
 			vkDestroyDevice(device, nullptr);
 		#ifdef VK_DEBUG_CALLBACK
 			if (debugCallback) {
@@ -266,15 +303,21 @@ namespace Backend {
 		}
 
 		bool GraphicsVulkan::StartGraphics(bool& _present_mode_fifo, bool& _triple_buffering) {
-			if (!InitSurface()) {
-				return false;
-			}
+			if (headless) {
+				if (!InitOffscreenTargets()) {
+					return false;
+				}
+			} else {
+				if (!InitSurface()) {
+					return false;
+				}
 
-			presentMode = (_present_mode_fifo ? VK_PRESENT_MODE_FIFO_KHR : VK_PRESENT_MODE_IMMEDIATE_KHR);
-			minImageCount = (_triple_buffering ? 3 : 2);
+				presentMode = (_present_mode_fifo ? VK_PRESENT_MODE_FIFO_KHR : VK_PRESENT_MODE_IMMEDIATE_KHR);
+				minImageCount = (_triple_buffering ? 3 : 2);
 
-			if (!InitSwapchain(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT)) {
-				return false;
+				if (!InitSwapchain(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT)) {
+					return false;
+				}
 			}
 			if (!InitRenderPass()) {
 				return false;
@@ -285,8 +328,14 @@ namespace Backend {
 			if (!InitCommandBuffers()) {
 				return false;
 			}
+			if (!resizableBar && !InitUploadRing(UPLOAD_RING_SIZE)) {
+				return false;
+			}
+			// optional, rendering works without
+			InitTimestampQueries();
 
 			bindPipelines = &GraphicsVulkan::BindPipelinesDummy;
+			staticCommandsDirty = true;
 			updateFunction = &GraphicsVulkan::UpdateDummy;
 
 			_present_mode_fifo = (presentMode == VK_PRESENT_MODE_FIFO_KHR ? true : false);
@@ -296,15 +345,25 @@ namespace Backend {
 		}
 
 		void GraphicsVulkan::StopGraphics() {
+			StopShaderCompilation();
+
+			DestroyUploadRing();
+			DestroyTimestampQueries();
 			DestroyCommandBuffer();
 			DestroyFrameBuffers();
 			DestroyPipelines();
 			DestroyRenderPass();
-			DestroySwapchain(false);
-			DestroySurface();
+			if (headless) {
+				DestroyOffscreenTargets();
+			} else {
+				DestroySwapchain();
+				DestroySurface();
+			}
 		}
 
 		void GraphicsVulkan::SetSwapchainSettings(bool& _present_mode_fifo, bool& _triple_buffering) {
+			if (headless) { return; }
+
 			presentMode = (_present_mode_fifo ? VK_PRESENT_MODE_FIFO_KHR : VK_PRESENT_MODE_IMMEDIATE_KHR);
 			if (presentMode == VK_PRESENT_MODE_FIFO_KHR) {
 				minImageCount = 2;
@@ -322,6 +381,10 @@ namespace Backend {
 		}
 
 		bool GraphicsVulkan::Init2dGraphicsBackend() {
+			if (!InitTex2dLayers()) {
+				return false;
+			}
+
 			for (int i = 0; i < FRAMES_IN_FLIGHT_2D; i++) {
 				VkCommandPoolCreateInfo cmd_pool_info = { VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
 				cmd_pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
@@ -376,6 +439,10 @@ namespace Backend {
 
 			if (!InitTex2dSampler()) { return false; }
 
+			// optional, the texture gets presented directly without
+			upscaleData.changed = false;
+			InitUpscaleChain();
+
 			if (!InitTex2dDescriptorSets()) { return false; }
 
 			// shader to present 2d texture
@@ -387,6 +454,7 @@ namespace Backend {
 			RecalcTex2dScaleMatrix();
 
 			bindPipelines = &GraphicsVulkan::BindPipelines2d;
+			staticCommandsDirty = true;
 			updateFunction = &GraphicsVulkan::UpdateTex2d;
 
 			submitRunning.store(true);
@@ -395,6 +463,7 @@ namespace Backend {
 				LOG_ERROR("[vulkan] create queue submit thread");
 			}
 
+			tex2dData.force_update = true;
 			UpdateTex2d();
 
 			LOG_INFO("[vulkan] 2d graphics backend initialized");
@@ -409,7 +478,9 @@ namespace Backend {
 				queueSubmitThread.join();
 			}
 
+			FlushUploads();
 			WaitIdle();
+			DestroyUpscaleChain(true);
 			DestroyTex2dSampler();
 			DestroyTex2dPipeline();
 			vkDestroyDescriptorPool(device, tex2dData.descriptor_pool, nullptr);
@@ -434,30 +505,73 @@ namespace Backend {
 
 			updateFunction = &GraphicsVulkan::UpdateDummy;
 			bindPipelines = &GraphicsVulkan::BindPipelinesDummy;
+			staticCommandsDirty = true;
 
 			LOG_INFO("[vulkan] 2d graphics backend stopped");
 		}
 
 		void GraphicsVulkan::RenderFrame() {
+			TRACE_ZONE("RenderFrame");
+
 			u32 image_index = 0;
 			static u32 frame_index = 0;
 			static bool rebuild = false;
 
+			// turn shaders compiled in the background into shader modules/pipelines
+			if (!shaderCompilationFinished) {
+				CompileNextShader();
+			}
+
+			// recorded before the acquire, a failure must not leave an image acquired and its semaphore signaled
+			if (staticCommandsDirty) {
+				// the secondaries may still be pending in other frames in flight, rare enough to simply wait
+				// (not after a swapchain rebuild, the previous ones got retired together with their framebuffers)
+				if (!staticCommandBuffers.empty() && vkWaitForFences(device, (u32)renderFences.size(), renderFences.data(), VK_TRUE, UINT64_MAX) != VK_SUCCESS) {
+					LOG_ERROR("[vulkan] wait for fences");
+					return;
+				}
+				if (!RecordStaticCommands()) {
+					return;
+				}
+			}
+
+			steady_clock::time_point block_begin = steady_clock::now();
+
 			// wait for fence that signals processing of submitted command buffer finished
 			if (vkWaitForFences(device, 1, &renderFences[frame_index], VK_TRUE, UINT64_MAX) != VK_SUCCESS) {
 				LOG_ERROR("[vulkan] wait for fences");
 				return;
 			}
 
-			if (VkResult result = vkAcquireNextImageKHR(device, swapchain, UINT64_MAX, acquireSemaphores[frame_index], 0, &image_index); result != VK_SUCCESS) {
+			// timestamps of the previous use of this frame are available now
+			u32 query_base = frame_index * TIMESTAMPS_RENDER;
+			if (u64 ticks[TIMESTAMPS_RENDER]; timestampsWritten[frame_index] && ReadTimestamps(query_base, TIMESTAMPS_RENDER, ticks)) {
+				unique_lock<mutex> lock_timings(mutGpuTimings);
+				gpuTimeDraw2d.add(TimestampDeltaMs(ticks[0], ticks[1]));
+				gpuTimeImgui.add(TimestampDeltaMs(ticks[1], ticks[2]));
+			}
+
+			if (headless) {
+				image_index = frame_index;
+			} else if (VkResult result = vkAcquireNextImageKHR(device, swapchain, UINT64_MAX, acquireSemaphores[frame_index], 0, &image_index); result != VK_SUCCESS) {
 				if (result == VK_SUBOPTIMAL_KHR) {
 					rebuild = true;
+				} else if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+					// nothing acquired (semaphore stays unsignaled) -> skip this frame
+					unique_lock<mutex> lock_queue(mutQueue);
+					RebuildSwapchain();
+					RecalcTex2dScaleMatrix();
+					rebuild = false;
+					return;
 				} else {
 					LOG_ERROR("[vulkan] acquire image from swapchain");
 					return;
 				}
 			}
 
+			nanoseconds blocked = duration_cast<nanoseconds>(steady_clock::now() - block_begin);
+			steady_clock::time_point record_begin = block_begin + blocked;
+
 			if (vkResetFences(device, 1, &renderFences[frame_index]) != VK_SUCCESS) {
 				LOG_ERROR("[vulkan] reset fences");
 			}
@@ -475,73 +589,282 @@ namespace Backend {
 					LOG_ERROR("[vulkan] begin command buffer");
 				}
 
+				if (timestampPool != VK_NULL_HANDLE) {
+					vkCmdResetQueryPool(commandBuffer, timestampPool, query_base, TIMESTAMPS_RENDER);
+					vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampPool, query_base);
+					timestampsWritten[frame_index] = true;
+				}
+
 				// render commands
-				VkRenderPassBeginInfo begin_info = {};
-				begin_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-				begin_info.renderPass = renderPass;
-				begin_info.framebuffer = frameBuffers[image_index];
-				begin_info.renderArea = { {0, 0}, {win_width, win_height} };
-				begin_info.clearValueCount = 1;
-				begin_info.pClearValues = &clearColor;
-				vkCmdBeginRenderPass(commandBuffer, &begin_info, VK_SUBPASS_CONTENTS_INLINE);
-
-				(this->*bindPipelines)(commandBuffer);
-
-				// imgui -> last
+				const VkFramebuffer framebuffer = dynamicRendering ? VK_NULL_HANDLE : frameBuffers[image_index];
+				if (dynamicRendering) {
+					// content gets cleared, only wait for the previous use of the image (present engine -> acquire semaphore/readback)
+					ImageBarrier(commandBuffer, images[image_index], VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+						VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR | (headless ? VK_PIPELINE_STAGE_2_COPY_BIT_KHR : VK_PIPELINE_STAGE_2_NONE_KHR), VK_ACCESS_2_NONE_KHR,
+						VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT_KHR);
+
+					VkRenderingAttachmentInfoKHR color_attachment = { VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR };
+					color_attachment.imageView = imageViews[image_index];
+					color_attachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+					color_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+					color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+					color_attachment.clearValue = clearColor;
+
+					VkRenderingInfoKHR rendering_info = { VK_STRUCTURE_TYPE_RENDERING_INFO_KHR };
+					rendering_info.flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT_KHR;
+					rendering_info.renderArea = { {0, 0}, {win_width, win_height} };
+					rendering_info.layerCount = 1;
+					rendering_info.colorAttachmentCount = 1;
+					rendering_info.pColorAttachments = &color_attachment;
+					pfnCmdBeginRendering(commandBuffer, &rendering_info);
+				} else {
+					VkRenderPassBeginInfo begin_info = {};
+					begin_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+					begin_info.renderPass = renderPass;
+					begin_info.framebuffer = framebuffer;
+					begin_info.renderArea = { {0, 0}, {win_width, win_height} };
+					begin_info.clearValueCount = 1;
+					begin_info.pClearValues = &clearColor;
+					vkCmdBeginRenderPass(commandBuffer, &begin_info, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+				}
+
+				vkCmdExecuteCommands(commandBuffer, 1, &staticCommandBuffers[image_index]);
+
+				// imgui -> last, timestamps have to be written from within the secondary command buffer
+				VkCommandBuffer& imguiBuffer = imguiCommandBuffers[frame_index];
+				if (!BeginSecondaryCommandBuffer(imguiBuffer, framebuffer, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT)) {
+					LOG_ERROR("[vulkan] begin imgui command buffer");
+				}
+
+				if (timestampPool != VK_NULL_HANDLE) {
+					vkCmdWriteTimestamp(imguiBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampPool, query_base + 1);
+				}
+
 				ImGui::Render();
 				ImDrawData* drawData = ImGui::GetDrawData();
-				ImGui_ImplVulkan_RenderDrawData(drawData, commandBuffer);
+				ImGui_ImplVulkan_RenderDrawData(drawData, imguiBuffer);
+
+				if (timestampPool != VK_NULL_HANDLE) {
+					vkCmdWriteTimestamp(imguiBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampPool, query_base + 2);
+				}
 
-				vkCmdEndRenderPass(commandBuffer);
+				if (vkEndCommandBuffer(imguiBuffer) != VK_SUCCESS) {
+					LOG_ERROR("[vulkan] end imgui command buffer");
+				}
+				vkCmdExecuteCommands(commandBuffer, 1, &imguiBuffer);
+
+				if (dynamicRendering) {
+					pfnCmdEndRendering(commandBuffer);
+
+					// layout the render pass would have left behind (present: release semaphore covers the rest)
+					if (headless) {
+						ImageBarrier(commandBuffer, images[image_index], VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+							VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT_KHR,
+							VK_PIPELINE_STAGE_2_COPY_BIT_KHR, VK_ACCESS_2_TRANSFER_READ_BIT_KHR);
+					} else {
+						ImageBarrier(commandBuffer, images[image_index], VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+							VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT_KHR,
+							VK_PIPELINE_STAGE_2_NONE_KHR, VK_ACCESS_2_NONE_KHR);
+					}
+				} else {
+					vkCmdEndRenderPass(commandBuffer);
+				}
+
+				if (headless) {
+					RecordReadback(commandBuffer, image_index);
+				}
 
 				if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
 					LOG_ERROR("[vulkan] end command buffer");
 				}
 			}
 
+			// pending uploads go to the queue ahead of the frame that uses them
+			FlushUploads();
+
 			// submit buffer to queue
 			VkSubmitInfo submit_info = {};
 			submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 			submit_info.commandBufferCount = 1;
 			submit_info.pCommandBuffers = &commandBuffers[frame_index];
-			submit_info.waitSemaphoreCount = 1;
+			submit_info.waitSemaphoreCount = headless ? 0 : 1;
 			submit_info.pWaitSemaphores = &acquireSemaphores[frame_index];
 			submit_info.pWaitDstStageMask = &waitFlags;
-			submit_info.signalSemaphoreCount = 1;
+			submit_info.signalSemaphoreCount = headless ? 0 : 1;
 			submit_info.pSignalSemaphores = &releaseSemaphores[frame_index];
 			{
 				unique_lock<mutex> lock_queue(mutQueue);
 				if (vkQueueSubmit(queue, 1, &submit_info, renderFences[frame_index]) != VK_SUCCESS) {
 					LOG_ERROR("[vulkan] submit command buffer to queue");
 				}
+				frameSerials[frame_index] = ++submitSerial;
+
+				{
+					unique_lock<mutex> lock_latency(mutLatency);
+					steady_clock::time_point submitted = steady_clock::now();
+					frameWork.add(duration_cast<nanoseconds>(submitted - inputSampleTime).count() / 1e6f);
+					frameRecording.add(duration_cast<nanoseconds>(submitted - record_begin).count() / 1e6f);
+				}
+
+				if (headless) {
+					readbackFrames[frame_index] = ++frameCounter;
+					UpdateFrameStartDelay(blocked);
+					++frame_index %= framesInFlight;
+					return;
+				}
 
 				// present
+				VkPresentIdKHR present_id_info = { VK_STRUCTURE_TYPE_PRESENT_ID_KHR };
+				u64 present_id = ++presentId;
+				present_id_info.swapchainCount = 1;
+				present_id_info.pPresentIds = &present_id;
+
+				// the previous present of this frame in flight is long done in practice, the fence gets reused
+				VkSwapchainPresentFenceInfoEXT present_fence_info = { VK_STRUCTURE_TYPE_SWAPCHAIN_PRESENT_FENCE_INFO_EXT };
+				present_fence_info.pNext = presentWaitSupported ? &present_id_info : nullptr;
+				if (swapchainMaintenance) {
+					if (presentSerials[frame_index] != 0 && vkWaitForFences(device, 1, &presentFences[frame_index], VK_TRUE, UINT64_MAX) != VK_SUCCESS) {
+						LOG_ERROR("[vulkan] wait for present fence");
+					}
+					presentSerials[frame_index] = 0;
+					if (vkResetFences(device, 1, &presentFences[frame_index]) != VK_SUCCESS) {
+						LOG_ERROR("[vulkan] reset present fence");
+					}
+					present_fence_info.swapchainCount = 1;
+					present_fence_info.pFences = &presentFences[frame_index];
+				}
+
 				VkPresentInfoKHR present_info = {};
 				present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+				present_info.pNext = swapchainMaintenance ? &present_fence_info : present_fence_info.pNext;
 				present_info.pSwapchains = &swapchain;
 				present_info.swapchainCount = 1;
 				present_info.pImageIndices = &image_index;
 				present_info.waitSemaphoreCount = 1;
 				present_info.pWaitSemaphores = &releaseSemaphores[frame_index];
-				if (VkResult result = vkQueuePresentKHR(queue, &present_info); result != VK_SUCCESS) {
-					if (rebuild || result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
-						RebuildSwapchain();
-						RecalcTex2dScaleMatrix();
-						rebuild = false;
-					}
-					else {
-						LOG_ERROR("[vulkan] present result");
+				steady_clock::time_point present_begin = steady_clock::now();
+				VkResult present_result = vkQueuePresentKHR(queue, &present_info);
+				// the fence only gets signaled if the present got queued (out of date still executes the semaphore wait)
+				if (swapchainMaintenance && (present_result == VK_SUCCESS || present_result == VK_SUBOPTIMAL_KHR || present_result == VK_ERROR_OUT_OF_DATE_KHR)) {
+					presentSerials[frame_index] = ++presentSerial;
+				}
+				{
+					unique_lock<mutex> lock_latency(mutLatency);
+					framePresent.add(duration_cast<nanoseconds>(steady_clock::now() - present_begin).count() / 1e6f);
+				}
+
+				bool rebuilt = false;
+				if (rebuild || present_result == VK_ERROR_OUT_OF_DATE_KHR || present_result == VK_SUBOPTIMAL_KHR) {
+					RebuildSwapchain();
+					rebuilt = true;
+					RecalcTex2dScaleMatrix();
+					rebuild = false;
+				} else if (present_result != VK_SUCCESS) {
+					LOG_ERROR("[vulkan] present result");
+				}
+
+				if (!retiredSwapchains.empty()) {
+					DestroyRetiredSwapchains(false);
+				}
+
+				if (presentWaitSupported) {
+					// ids of a rebuilt swapchain are gone
+					if (!rebuilt) {
+						pendingPresents.emplace_back(present_id, inputSampleTime);
 					}
+					PollPresentWait();
+				} else {
+					unique_lock<mutex> lock_latency(mutLatency);
+					inputToPresent.add(duration_cast<nanoseconds>(steady_clock::now() - inputSampleTime).count() / 1e6f);
+				}
+			}
+
+			UpdateFrameStartDelay(blocked);
+			++frame_index %= framesInFlight;
+		}
+
+		// expects mutQueue to be locked (swapchain access), only polls -> latency resolution is one frame
+		void GraphicsVulkan::PollPresentWait() {
+			while (!pendingPresents.empty()) {
+				auto& [id, input_time] = pendingPresents.front();
+				VkResult result = pfnWaitForPresent(device, swapchain, id, 0);
+				if (result == VK_TIMEOUT) {
+					break;
+				}
+				if (result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR) {
+					unique_lock<mutex> lock_latency(mutLatency);
+					inputToPresent.add(duration_cast<nanoseconds>(steady_clock::now() - input_time).count() / 1e6f);
 				}
+				pendingPresents.pop_front();
+			}
+
+			// presents that never complete (e.g. minimized window) shouldn't pile up
+			while (pendingPresents.size() > FRAMES_IN_FLIGHT + 4) {
+				pendingPresents.pop_front();
+			}
+		}
+
+		void GraphicsVulkan::UpdateFrameStartDelay(const nanoseconds& _blocked) {
+			steady_clock::time_point now = steady_clock::now();
+			{
+				unique_lock<mutex> lock_latency(mutLatency);
+				frameInterval.add(duration_cast<nanoseconds>(now - lastFrameStart).count() / 1e6f);
+				frameBlocked.add(_blocked.count() / 1e6f);
 			}
+			lastFrameStart = now;
 
-			++frame_index %= FRAMES_IN_FLIGHT;
+			if (!lowLatency) {
+				frameStartDelayNs.store(0);
+				return;
+			}
+
+			// time spent blocking on the GPU/swapchain is time the input could have been sampled later,
+			// move the start towards it slowly and back off fast when the frame gets late (keep a safety margin)
+			const i64 margin = 1000000;
+			i64 delay = frameStartDelayNs.load();
+			i64 slack = (i64)_blocked.count() - margin;
+			if (slack > 0) {
+				delay += slack / 8;
+			} else {
+				delay += slack / 2;
+			}
+
+			i64 max_delay = (i64)(frameInterval.get().avg * 1e6f * .75f);
+			frameStartDelayNs.store(std::clamp(delay, (i64)0, std::max(max_delay, (i64)0)));
+		}
+
+		void GraphicsVulkan::SetLowLatencyMode(const bool& _enable, const bool& _single_frame_in_flight) {
+			lowLatency = _enable;
+			singleFrameInFlight = _single_frame_in_flight;
+			framesInFlight = (lowLatency && singleFrameInFlight) ? 1 : FRAMES_IN_FLIGHT;
+			if (!lowLatency) {
+				frameStartDelayNs.store(0);
+			}
+		}
+
+		latency_stats GraphicsVulkan::GetLatencyStats() {
+			latency_stats stats = {};
+			stats.low_latency = lowLatency;
+			stats.present_wait = presentWaitSupported;
+			stats.frames_in_flight = framesInFlight;
+			stats.start_delay = frameStartDelayNs.load() / 1e6f;
+
+			unique_lock<mutex> lock_latency(mutLatency);
+			stats.input_to_present = inputToPresent.get();
+			stats.frame_work = frameWork.get();
+			stats.blocked = frameBlocked.get();
+			stats.recording = frameRecording.get();
+			stats.present = framePresent.get();
+			return stats;
 		}
 
 		void GraphicsVulkan::QueueSubmit() {
+			TRACE_THREAD_NAME("vulkan submit");
+
 			while (submitRunning.load()) {
 				unique_lock<mutex> lock_submit(mutSubmit);
 				queueNotify.wait(lock_submit);
+				TRACE_ZONE("QueueSubmit");
 
 				for (auto& n : queueSubmitData) {
 					VkSubmitInfo submitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
@@ -572,22 +895,45 @@ namespace Backend {
 			vkCmdBindVertexBuffers(_command_buffer, 0, 1, &tex2dData.vertex_buffer.buffer, &offset);
 			vkCmdBindIndexBuffer(_command_buffer, tex2dData.index_buffer.buffer, 0, VK_INDEX_TYPE_UINT32);
 			vkCmdBindDescriptorSets(_command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, tex2dData.pipeline_layout, 0, 1, &tex2dData.descriptor_set, 0, nullptr);
-			vkCmdPushConstants(_command_buffer, tex2dData.pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &tex2dData.scale_matrix);
+			if (tex2dData.layered) {
+				tex2d_layer_push_constants params = {};
+				for (size_t i = 0; i < tex2dData.layers.size(); i++) {
+					memcpy(params.transform[i], &tex2dData.layers[i].transform, sizeof(params.transform[i]));
+					memcpy(params.uv_scale[i], &tex2dData.layers[i].uv_scale, sizeof(params.uv_scale[i]));
+				}
+				vkCmdPushConstants(_command_buffer, tex2dData.pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(params), &params);
+			} else {
+				vkCmdPushConstants(_command_buffer, tex2dData.pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &tex2dData.scale_matrix);
+			}
 			vkCmdSetViewport(_command_buffer, 0, 1, &viewport);
 			vkCmdSetScissor(_command_buffer, 0, 1, &scissor);
-			vkCmdDrawIndexed(_command_buffer, sizeof(indexData) / sizeof(u32), 1, 0, 0, 0);
+			// one instance per layer
+			vkCmdDrawIndexed(_command_buffer, sizeof(indexData) / sizeof(u32), tex2dData.layered ? (u32)tex2dData.layers.size() : 1, 0, 0, 0);
 		}
 
 		void GraphicsVulkan::RecalcTex2dScaleMatrix() {
-			if (aspectRatio > virtGraphicsInfo.aspect_ratio) {
-				tex2dData.scale_x = virtGraphicsInfo.aspect_ratio / aspectRatio;
-				tex2dData.scale_y = 1.f;
-			} else {
-				tex2dData.scale_x = 1.f;
-				tex2dData.scale_y = (1.f / virtGraphicsInfo.aspect_ratio) / (1.f / aspectRatio);
+			// every layer gets fitted into its rect (centred, aspect ratio kept)
+			for (auto& n : tex2dData.layers) {
+				const graphics_layer_information& info = n.info;
+				float rect_aspect = aspectRatio * info.width / info.height;
+				float scale_x = info.width;
+				float scale_y = info.height;
+				if (rect_aspect > info.aspect_ratio) {
+					scale_x *= info.aspect_ratio / rect_aspect;
+				} else {
+					scale_y *= rect_aspect / info.aspect_ratio;
+				}
+				n.transform = glm::vec4(scale_x, scale_y, (info.x + info.width * .5f) * 2.f - 1.f, (info.y + info.height * .5f) * 2.f - 1.f);
 			}
 
-			tex2dData.scale_matrix = glm::scale(glm::mat4(1.f), glm::vec3(tex2dData.scale_x, tex2dData.scale_y, 1.f));
+			// single layer: the precompiled pipeline gets the transform as matrix
+			if (!tex2dData.layers.empty()) {
+				const glm::vec4& transform = tex2dData.layers[0].transform;
+				tex2dData.scale_x = transform.x;
+				tex2dData.scale_y = transform.y;
+				tex2dData.scale_matrix = glm::translate(glm::mat4(1.f), glm::vec3(transform.z, transform.w, 0.f)) * glm::scale(glm::mat4(1.f), glm::vec3(transform.x, transform.y, 1.f));
+			}
+			staticCommandsDirty = true;
 		}
 
 		void GraphicsVulkan::UpdateTexture2d() {
@@ -595,9 +941,27 @@ namespace Backend {
 		}
 
 		void GraphicsVulkan::UpdateTex2d() {
+			TRACE_ZONE("UpdateTex2d");
+
 			int& update_index = tex2dData.update_index;
 			std::atomic<bool>* signal = tex2dData.cmdbufSubmitSignals[update_index];
 
+			// updates recorded but not yet submitted still reference the current chain -> try again next time
+			if (upscaleData.changed) {
+				bool submitted = true;
+				for (const auto& n : tex2dData.cmdbufSubmitSignals) {
+					submitted &= n->load();
+				}
+				if (!submitted) { return; }
+
+				WaitIdle();
+				DestroyUpscaleChain(false);
+				InitUpscaleChain();
+				WriteTex2dDescriptorSet();
+				upscaleData.changed = false;
+				tex2dData.force_update = true;
+			}
+
 			if (signal->load()) {
 				VkResult result = vkWaitForFences(device, 1, &tex2dData.update_fence[update_index], VK_TRUE, 0);
 				switch (result) {
@@ -612,11 +976,42 @@ namespace Backend {
 					break;
 				}
 
+				// mailbox: only upload layers the emulation finished a new frame for, nothing new at all -> the fence stays signaled
+				bool updated[TEX2D_LAYERS_MAX] = {};
+				bool any_updated = false;
+				for (size_t i = 0; i < tex2dData.layers.size(); i++) {
+					const tex2d_layer& layer = tex2dData.layers[i];
+					const std::vector<u8>* image_data = layer.info.image_data;
+					if (layer.info.mailbox != nullptr) {
+						if (!layer.info.mailbox->consume() && !tex2dData.force_update) {
+							continue;
+						}
+						image_data = &layer.info.mailbox->read_buffer();
+					}
+					if (image_data == nullptr || image_data->size() < layer.size) {
+						LOG_ERROR("[vulkan] texture2d data size mismatch (layer ", i, ")");
+						continue;
+					}
+
+					memcpy((u8*)tex2dData.mapped_image_data[update_index] + layer.offset, image_data->data(), layer.size);
+					if (i == 0 && frameCapture != nullptr) {
+						frameCapture->PushFrame(image_data->data(), layer.size, layer.info.lcd_width, layer.info.lcd_height);
+					}
+					updated[i] = true;
+					any_updated = true;
+				}
+				tex2dData.force_update = false;
+				if (!any_updated) { return; }
+
 				if (vkResetFences(device, 1, &tex2dData.update_fence[update_index]) != VK_SUCCESS) {
 					LOG_ERROR("[vulkan] reset texture2d update fence");
 				}
 
-				memcpy(tex2dData.mapped_image_data[update_index], virtGraphicsInfo.image_data->data(), virtGraphicsInfo.image_data->size());
+				u32 query_base = FRAMES_IN_FLIGHT * TIMESTAMPS_RENDER + update_index * TIMESTAMPS_UPLOAD;
+				if (u64 ticks[TIMESTAMPS_UPLOAD]; timestampsWritten[FRAMES_IN_FLIGHT + update_index] && ReadTimestamps(query_base, TIMESTAMPS_UPLOAD, ticks)) {
+					unique_lock<mutex> lock_timings(mutGpuTimings);
+					gpuTimeUpload.add(TimestampDeltaMs(ticks[0], ticks[1]));
+				}
 
 				if (vkResetCommandPool(device, tex2dData.command_pool[update_index], 0) != VK_SUCCESS) {
 					LOG_ERROR("[vulkan] reset texture2d command pool");
@@ -628,42 +1023,38 @@ namespace Backend {
 					LOG_ERROR("[vulkan] begin command buffer texture2d update");
 				}
 
-				// synchronize texture upload to shader stages -> shader stage TRANSFER with corresponding access mask for TRANSFER (L2 Cache) 
-				// to make sure the copy is not interfering with the fragment shader read and image is in proper layout and memory location for update
-				{
-					VkImageMemoryBarrier imageBarrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
-					imageBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-					imageBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-					imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-					imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-					imageBarrier.image = tex2dData.image.image;
-					imageBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-					imageBarrier.subresourceRange.levelCount = 1;
-					imageBarrier.subresourceRange.layerCount = 1;
-					imageBarrier.srcAccessMask = VK_ACCESS_NONE;
-					imageBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-					vkCmdPipelineBarrier(tex2dData.command_buffer[update_index], VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageBarrier);
-				}
-
-				VkBufferImageCopy region = {};
-				region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-				region.imageSubresource.layerCount = 1;
-				region.imageExtent = { virtGraphicsInfo.lcd_width, virtGraphicsInfo.lcd_height, 1 };
-				vkCmdCopyBufferToImage(tex2dData.command_buffer[update_index], tex2dData.staging_buffer[update_index].buffer, tex2dData.image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+				if (timestampPool != VK_NULL_HANDLE) {
+					vkCmdResetQueryPool(tex2dData.command_buffer[update_index], timestampPool, query_base, TIMESTAMPS_UPLOAD);
+					vkCmdWriteTimestamp(tex2dData.command_buffer[update_index], VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampPool, query_base);
+					timestampsWritten[FRAMES_IN_FLIGHT + update_index] = true;
+				}
 
-				{
-					VkImageMemoryBarrier imageBarrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
-					imageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-					imageBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-					imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-					imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-					imageBarrier.image = tex2dData.image.image;
-					imageBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-					imageBarrier.subresourceRange.levelCount = 1;
-					imageBarrier.subresourceRange.layerCount = 1;
-					imageBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-					imageBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-					vkCmdPipelineBarrier(tex2dData.command_buffer[update_index], VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageBarrier);
+				// synchronize texture upload to shader stages -> the copy only has to wait for the stage reading the previous content
+				// (write after read, no memory dependency), the reader waits for the copy only; unchanged layers keep their content
+				const VkPipelineStageFlags2KHR reader_stage = upscaleData.stages.empty() ? VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT_KHR : VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR;
+				for (size_t i = 0; i < tex2dData.layers.size(); i++) {
+					if (!updated[i]) { continue; }
+					const tex2d_layer& layer = tex2dData.layers[i];
+
+					ImageBarrier(tex2dData.command_buffer[update_index], tex2dData.image.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+						reader_stage, VK_ACCESS_2_NONE_KHR, VK_PIPELINE_STAGE_2_COPY_BIT_KHR, VK_ACCESS_2_TRANSFER_WRITE_BIT_KHR, (u32)i);
+
+					VkBufferImageCopy region = {};
+					region.bufferOffset = layer.offset;
+					region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+					region.imageSubresource.baseArrayLayer = (u32)i;
+					region.imageSubresource.layerCount = 1;
+					region.imageExtent = { layer.info.lcd_width, layer.info.lcd_height, 1 };
+					vkCmdCopyBufferToImage(tex2dData.command_buffer[update_index], tex2dData.staging_buffer[update_index].buffer, tex2dData.image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+					ImageBarrier(tex2dData.command_buffer[update_index], tex2dData.image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+						VK_PIPELINE_STAGE_2_COPY_BIT_KHR, VK_ACCESS_2_TRANSFER_WRITE_BIT_KHR, reader_stage, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT_KHR, (u32)i);
+				}
+
+				RecordUpscaleChain(tex2dData.command_buffer[update_index]);
+
+				if (timestampPool != VK_NULL_HANDLE) {
+					vkCmdWriteTimestamp(tex2dData.command_buffer[update_index], VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampPool, query_base + 1);
 				}
 
 				if (vkEndCommandBuffer(tex2dData.command_buffer[update_index]) != VK_SUCCESS) {
@@ -708,11 +1099,32 @@ namespace Backend {
 			validation_features.pEnabledValidationFeatures = validation_features_list.data();
 		#endif
 
+			// 1.1 if available (vkGetPhysicalDeviceFeatures2 for optional device features), vkEnumerateInstanceVersion doesn't exist on 1.0 loaders
+			u32 instance_version = VK_API_VERSION_1_0;
+			if (auto pfn_enumerate_version = (PFN_vkEnumerateInstanceVersion)vkGetInstanceProcAddr(nullptr, "vkEnumerateInstanceVersion"); pfn_enumerate_version != nullptr) {
+				pfn_enumerate_version(&instance_version);
+			}
+			apiVersion = instance_version >= VK_API_VERSION_1_1 ? VK_API_VERSION_1_1 : VK_API_VERSION_1_0;
+
 			VkApplicationInfo vk_app_info = {};
 			vk_app_info.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
 			vk_app_info.pApplicationName = title.c_str();
 			vk_app_info.applicationVersion = VK_MAKE_VERSION(vMajor, vMinor, vPatch);
-			vk_app_info.apiVersion = VK_API_VERSION_1_0;
+			vk_app_info.apiVersion = apiVersion;
+
+			// required by VK_EXT_swapchain_maintenance1 (present fences)
+			auto instance_extension_available = [&vk_extension_properties](const char* _name) -> bool {
+				for (const auto& n : vk_extension_properties) {
+					if (strcmp(n.extensionName, _name) == 0) { return true; }
+				}
+				return false;
+			};
+			surfaceMaintenance = false;
+			if (!headless && instance_extension_available(VK_KHR_GET_SURFACE_CAPABILITIES_2_EXTENSION_NAME) && instance_extension_available(VK_EXT_SURFACE_MAINTENANCE_1_EXTENSION_NAME)) {
+				surfaceMaintenance = true;
+				_sdl_extensions.emplace_back(VK_KHR_GET_SURFACE_CAPABILITIES_2_EXTENSION_NAME);
+				_sdl_extensions.emplace_back(VK_EXT_SURFACE_MAINTENANCE_1_EXTENSION_NAME);
+			}
 
 			VkInstanceCreateInfo vk_create_info = {};
 			vk_create_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -821,8 +1233,103 @@ namespace Backend {
 
 			VkPhysicalDeviceFeatures vk_enabled_features = {};
 
+			// optional extensions
+			u32 extension_count = 0;
+			vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extension_count, nullptr);
+			auto extension_properties = std::vector<VkExtensionProperties>(extension_count);
+			vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extension_count, extension_properties.data());
+			auto extension_available = [&extension_properties](const char* _name) -> bool {
+				for (const auto& n : extension_properties) {
+					if (strcmp(n.extensionName, _name) == 0) { return true; }
+				}
+				return false;
+			};
+
+			// present timing for measuring input to present latency
+			VkPhysicalDevicePresentIdFeaturesKHR present_id_features = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR };
+			VkPhysicalDevicePresentWaitFeaturesKHR present_wait_features = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR };
+			present_wait_features.pNext = &present_id_features;
+			presentWaitSupported = false;
+			if (!headless && apiVersion >= VK_API_VERSION_1_1 && physicalDeviceProperties.apiVersion >= VK_API_VERSION_1_1 &&
+				extension_available(VK_KHR_PRESENT_ID_EXTENSION_NAME) && extension_available(VK_KHR_PRESENT_WAIT_EXTENSION_NAME)) {
+				VkPhysicalDeviceFeatures2 features = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2 };
+				features.pNext = &present_wait_features;
+				vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+
+				if (present_id_features.presentId && present_wait_features.presentWait) {
+					presentWaitSupported = true;
+					_device_extensions.emplace_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+					_device_extensions.emplace_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+					present_id_features = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR, nullptr, VK_TRUE };
+					present_wait_features = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR, &present_id_features, VK_TRUE };
+				}
+			}
+
+			// present fences for retiring swapchains
+			VkPhysicalDeviceSwapchainMaintenance1FeaturesEXT swapchain_maintenance_features = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SWAPCHAIN_MAINTENANCE_1_FEATURES_EXT };
+			swapchainMaintenance = false;
+			if (surfaceMaintenance && apiVersion >= VK_API_VERSION_1_1 && physicalDeviceProperties.apiVersion >= VK_API_VERSION_1_1 &&
+				extension_available(VK_EXT_SWAPCHAIN_MAINTENANCE_1_EXTENSION_NAME)) {
+				VkPhysicalDeviceFeatures2 features = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2 };
+				features.pNext = &swapchain_maintenance_features;
+				vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+
+				if (swapchain_maintenance_features.swapchainMaintenance1) {
+					swapchainMaintenance = true;
+					_device_extensions.emplace_back(VK_EXT_SWAPCHAIN_MAINTENANCE_1_EXTENSION_NAME);
+				}
+			}
+
+			// dynamic rendering/synchronization2, both optional (render pass/legacy barriers as fallback)
+			VkPhysicalDeviceSynchronization2FeaturesKHR synchronization2_features = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR };
+			VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamic_rendering_features = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR };
+			dynamic_rendering_features.pNext = &synchronization2_features;
+			dynamicRendering = false;
+			synchronization2 = false;
+			// depth_stencil_resolve/create_renderpass2 are dependencies of dynamic_rendering (not core below 1.2)
+			bool dynamic_rendering_available = extension_available(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME) &&
+				extension_available(VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME) && extension_available(VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME);
+			bool synchronization2_available = extension_available(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+			if (apiVersion >= VK_API_VERSION_1_1 && physicalDeviceProperties.apiVersion >= VK_API_VERSION_1_1 &&
+				(dynamic_rendering_available || synchronization2_available)) {
+				VkPhysicalDeviceFeatures2 features = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2 };
+				features.pNext = &dynamic_rendering_features;
+				vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+
+				if (dynamic_rendering_available && dynamic_rendering_features.dynamicRendering) {
+					dynamicRendering = true;
+					_device_extensions.emplace_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+					_device_extensions.emplace_back(VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME);
+					_device_extensions.emplace_back(VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME);
+				}
+				if (synchronization2_available && synchronization2_features.synchronization2) {
+					synchronization2 = true;
+					_device_extensions.emplace_back(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+				}
+			}
+
+			// chain of the enabled optional features
+			void* feature_chain = nullptr;
+			if (synchronization2) {
+				synchronization2_features = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR, feature_chain, VK_TRUE };
+				feature_chain = &synchronization2_features;
+			}
+			if (dynamicRendering) {
+				dynamic_rendering_features = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR, feature_chain, VK_TRUE };
+				feature_chain = &dynamic_rendering_features;
+			}
+			if (presentWaitSupported) {
+				present_id_features.pNext = feature_chain;
+				feature_chain = &present_wait_features;
+			}
+			if (swapchainMaintenance) {
+				swapchain_maintenance_features = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SWAPCHAIN_MAINTENANCE_1_FEATURES_EXT, feature_chain, VK_TRUE };
+				feature_chain = &swapchain_maintenance_features;
+			}
+
 			VkDeviceCreateInfo vk_device_info = {};
 			vk_device_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+			vk_device_info.pNext = feature_chain;
 			vk_device_info.queueCreateInfoCount = 1;
 			vk_device_info.pQueueCreateInfos = &queue_create_info;
 			vk_device_info.enabledExtensionCount = (u32)_device_extensions.size();
@@ -834,12 +1341,34 @@ namespace Backend {
 				return false;
 			}
 
+			if (presentWaitSupported) {
+				pfnWaitForPresent = (PFN_vkWaitForPresentKHR)vkGetDeviceProcAddr(device, "vkWaitForPresentKHR");
+				presentWaitSupported = pfnWaitForPresent != nullptr;
+			}
+			if (dynamicRendering) {
+				pfnCmdBeginRendering = (PFN_vkCmdBeginRenderingKHR)vkGetDeviceProcAddr(device, "vkCmdBeginRenderingKHR");
+				pfnCmdEndRendering = (PFN_vkCmdEndRenderingKHR)vkGetDeviceProcAddr(device, "vkCmdEndRenderingKHR");
+				dynamicRendering = pfnCmdBeginRendering != nullptr && pfnCmdEndRendering != nullptr;
+			}
+			if (synchronization2) {
+				pfnCmdPipelineBarrier2 = (PFN_vkCmdPipelineBarrier2KHR)vkGetDeviceProcAddr(device, "vkCmdPipelineBarrier2KHR");
+				synchronization2 = pfnCmdPipelineBarrier2 != nullptr;
+			}
+			LOG_INFO("[vulkan] ", dynamicRendering ? "dynamic rendering" : "render pass", ", ", synchronization2 ? "synchronization2" : "legacy barriers");
+			for (const auto& n : _device_extensions) {
+				LOG_INFO("[vulkan] ", n, " device extension enabled");
+			}
+
 			familyIndex = graphics_queue_index;
 			vkGetDeviceQueue(device, graphics_queue_index, 0, &queue);
+			timestampValidBits = queue_family_properties[graphics_queue_index].timestampValidBits;
+			computeSupported = (queue_family_properties[graphics_queue_index].queueFlags & VK_QUEUE_COMPUTE_BIT) != 0;
 
 			vkGetPhysicalDeviceMemoryProperties(physicalDevice, &devMemProps);
 			DetectResizableBar();
 
+			allocator.Init(device, devMemProps, physicalDeviceProperties.limits);
+
 			return true;
 		}
 
@@ -952,9 +1481,7 @@ namespace Backend {
 			images.resize(image_num);
 			if (vkGetSwapchainImagesKHR(device, swapchain, &image_num, images.data()) != VK_SUCCESS) { return false; }
 
-			for (auto& n : imageViews) {
-				vkDestroyImageView(device, n, nullptr);
-			}
+			// views of a previous swapchain are owned by retiredSwapchains
 			imageViews.clear();
 			imageViews.resize(image_num);
 			for (u32 i = 0; i < image_num; i++) {
@@ -978,13 +1505,16 @@ namespace Backend {
 		}
 
 		bool GraphicsVulkan::InitRenderPass() {
+			// dynamic rendering: attachment described at vkCmdBeginRenderingKHR
+			if (dynamicRendering) { return true; }
+
 			VkAttachmentDescription attachment_description = {};
 			attachment_description.format = swapchainFormat;
 			attachment_description.samples = sample_count;														// MSAA
 			attachment_description.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;										// clear previous
 			attachment_description.storeOp = VK_ATTACHMENT_STORE_OP_STORE;										// store result
 			attachment_description.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;									// before renderpass -> don't care
-			attachment_description.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;								// final tex2dFormat to present
+			attachment_description.finalLayout = headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;	// final tex2dFormat to present (or read back)
 
 			VkAttachmentReference attachment_reference = { 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };		// tex2dFormat for rendering
 			VkSubpassDescription subpass = {};
@@ -1008,7 +1538,10 @@ namespace Backend {
 		}
 
 		bool GraphicsVulkan::InitFrameBuffers() {
+			staticCommandsDirty = true;
 			frameBuffers.clear();
+			if (dynamicRendering) { return true; }
+
 			frameBuffers.resize(images.size());
 			for (u32 i = 0; i < images.size(); i++) {
 				VkFramebufferCreateInfo framebuffer_info = {};
@@ -1051,6 +1584,12 @@ namespace Backend {
 					return false;
 				}
 			}
+			for (auto& n : presentFences) {
+				if (vkCreateFence(device, &fence_info, nullptr, &n) != VK_SUCCESS) {
+					LOG_ERROR("[vulkan] create presentFence");
+					return false;
+				}
+			}
 
 			for (auto& n : acquireSemaphores) {
 				if (!InitSemaphore(n)) { return false; }
@@ -1071,8 +1610,121 @@ namespace Backend {
 					LOG_ERROR("[vulkan] allocate command buffers ", i);
 					return false;
 				}
+
+				allocate_info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+				if (vkAllocateCommandBuffers(device, &allocate_info, &imguiCommandBuffers[i]) != VK_SUCCESS) {
+					LOG_ERROR("[vulkan] allocate imgui command buffers ", i);
+					return false;
+				}
+			}
+
+			// not transient, static command buffers live until invalidated
+			cmdpool_info.flags = 0;
+			if (vkCreateCommandPool(device, &cmdpool_info, nullptr, &staticCommandPool) != VK_SUCCESS) {
+				LOG_ERROR("[vulkan] create static command pool");
+				return false;
+			}
+			staticCommandBuffers.clear();
+			staticCommandsDirty = true;
+
+			return true;
+		}
+
+		bool GraphicsVulkan::BeginSecondaryCommandBuffer(VkCommandBuffer& _command_buffer, const VkFramebuffer& _framebuffer, const VkCommandBufferUsageFlags& _flags) {
+			VkCommandBufferInheritanceInfo inheritance_info = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO };
+			inheritance_info.renderPass = renderPass;
+			inheritance_info.subpass = 0;
+			inheritance_info.framebuffer = _framebuffer;
+
+			VkCommandBufferInheritanceRenderingInfoKHR rendering_info = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO_KHR };
+			rendering_info.colorAttachmentCount = 1;
+			rendering_info.pColorAttachmentFormats = &swapchainFormat;
+			rendering_info.rasterizationSamples = sample_count;
+			if (dynamicRendering) {
+				inheritance_info.pNext = &rendering_info;
+			}
+
+			VkCommandBufferBeginInfo begin_info = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+			begin_info.flags = _flags | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+			begin_info.pInheritanceInfo = &inheritance_info;
+			return vkBeginCommandBuffer(_command_buffer, &begin_info) == VK_SUCCESS;
+		}
+
+		// masks in synchronization2 terms, without the extension the stages/accesses get widened to their legacy equivalents
+		void GraphicsVulkan::ImageBarrier(VkCommandBuffer& _command_buffer, const VkImage& _image, const VkImageLayout& _old_layout, const VkImageLayout& _new_layout,
+			const VkPipelineStageFlags2KHR& _src_stage, const VkAccessFlags2KHR& _src_access, const VkPipelineStageFlags2KHR& _dst_stage, const VkAccessFlags2KHR& _dst_access, const u32& _layer) {
+			if (synchronization2) {
+				VkImageMemoryBarrier2KHR image_barrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2_KHR };
+				image_barrier.srcStageMask = _src_stage;
+				image_barrier.srcAccessMask = _src_access;
+				image_barrier.dstStageMask = _dst_stage;
+				image_barrier.dstAccessMask = _dst_access;
+				image_barrier.oldLayout = _old_layout;
+				image_barrier.newLayout = _new_layout;
+				image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				image_barrier.image = _image;
+				image_barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, _layer, 1 };
+
+				VkDependencyInfoKHR dependency_info = { VK_STRUCTURE_TYPE_DEPENDENCY_INFO_KHR };
+				dependency_info.imageMemoryBarrierCount = 1;
+				dependency_info.pImageMemoryBarriers = &image_barrier;
+				pfnCmdPipelineBarrier2(_command_buffer, &dependency_info);
+			} else {
+				VkImageMemoryBarrier image_barrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+				image_barrier.srcAccessMask = legacy_access(_src_access);
+				image_barrier.dstAccessMask = legacy_access(_dst_access);
+				image_barrier.oldLayout = _old_layout;
+				image_barrier.newLayout = _new_layout;
+				image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				image_barrier.image = _image;
+				image_barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, _layer, 1 };
+				vkCmdPipelineBarrier(_command_buffer, legacy_stage(_src_stage, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT), legacy_stage(_dst_stage, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT), 0, 0, nullptr, 0, nullptr, 1, &image_barrier);
+			}
+		}
+
+		// expects none of the static command buffers to be pending
+		bool GraphicsVulkan::RecordStaticCommands() {
+			// no buffers -> retired with a swapchain and possibly still pending, the pool must not be reset then
+			if (!staticCommandBuffers.empty() && vkResetCommandPool(device, staticCommandPool, 0) != VK_SUCCESS) {
+				LOG_ERROR("[vulkan] reset static command pool");
+				return false;
+			}
+
+			// one per render target (no framebuffers with dynamic rendering)
+			if (staticCommandBuffers.size() != images.size()) {
+				if (!staticCommandBuffers.empty()) {
+					vkFreeCommandBuffers(device, staticCommandPool, (u32)staticCommandBuffers.size(), staticCommandBuffers.data());
+				}
+				staticCommandBuffers.assign(images.size(), VK_NULL_HANDLE);
+
+				VkCommandBufferAllocateInfo allocate_info = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+				allocate_info.commandPool = staticCommandPool;
+				allocate_info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+				allocate_info.commandBufferCount = (u32)staticCommandBuffers.size();
+				if (vkAllocateCommandBuffers(device, &allocate_info, staticCommandBuffers.data()) != VK_SUCCESS) {
+					LOG_ERROR("[vulkan] allocate static command buffers");
+					staticCommandBuffers.clear();
+					return false;
+				}
+			}
+
+			for (size_t i = 0; i < staticCommandBuffers.size(); i++) {
+				if (!BeginSecondaryCommandBuffer(staticCommandBuffers[i], frameBuffers.empty() ? VK_NULL_HANDLE : frameBuffers[i], 0)) {
+					LOG_ERROR("[vulkan] begin static command buffer ", i);
+					return false;
+				}
+
+				(this->*bindPipelines)(staticCommandBuffers[i]);
+
+				if (vkEndCommandBuffer(staticCommandBuffers[i]) != VK_SUCCESS) {
+					LOG_ERROR("[vulkan] end static command buffer ", i);
+					return false;
+				}
 			}
 
+			staticCommandsDirty = false;
 			return true;
 		}
 
@@ -1115,6 +1767,12 @@ namespace Backend {
 			init_info.ImageCount = (u32)images.size();
 			init_info.MSAASamples = sample_count;
 			init_info.RenderPass = renderPass;
+			if (dynamicRendering) {
+				init_info.UseDynamicRendering = true;
+				init_info.PipelineRenderingCreateInfo = { VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR };
+				init_info.PipelineRenderingCreateInfo.colorAttachmentCount = 1;
+				init_info.PipelineRenderingCreateInfo.pColorAttachmentFormats = &swapchainFormat;
+			}
 			if (!ImGui_ImplVulkan_Init(&init_info)) {
 				LOG_ERROR("[vulkan] init imgui");
 				return false;
@@ -1122,16 +1780,10 @@ namespace Backend {
 
 			// Upload Fonts
 			{
-				// font loading and atlas rebuild before font texture upload to GPU
-				ImGuiIO& io = ImGui::GetIO();
-				const char* font = fontMain.c_str();
-				if (fonts.size() == 0) { fonts.emplace_back(); }
-
-				io.Fonts->AddFontDefault();
-				fonts[0] = io.Fonts->AddFontFromFileTTF(font, 13.f, NULL, io.Fonts->GetGlyphRangesDefault());
-				IM_ASSERT(fonts[0] != nullptr);
-
-				io.Fonts->Build();
+				// font loading and atlas rebuild before font texture upload to GPU, unless already done during startup
+				if (fonts.size() == 0) {
+					LoadFonts();
+				}
 
 				if (vkResetCommandPool(device, commandPools[0], 0) != VK_SUCCESS) {
 					LOG_ERROR("[vulkan] imgui reset command pool");
@@ -1259,8 +1911,13 @@ namespace Backend {
 			dynamic_state.dynamicStateCount = 2;
 			dynamic_state.pDynamicStates = states;
 
+			VkPipelineRenderingCreateInfoKHR rendering_info = { VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR };
+			rendering_info.colorAttachmentCount = 1;
+			rendering_info.pColorAttachmentFormats = &swapchainFormat;
+
 			VkGraphicsPipelineCreateInfo pipeline_info = {};
 			pipeline_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+			pipeline_info.pNext = dynamicRendering ? &rendering_info : nullptr;
 			pipeline_info.stageCount = (u32)shader_stages.size();
 			pipeline_info.pStages = shader_stages.data();
 			pipeline_info.pVertexInputState = &vertex_input_state;
@@ -1283,7 +1940,7 @@ namespace Backend {
 			return true;
 		}
 
-		bool GraphicsVulkan::InitBuffer(vulkan_buffer& _buffer, u64 _size, VkBufferUsageFlags _usage, VkMemoryPropertyFlags _memory_properties) {
+		bool GraphicsVulkan::InitBuffer(vulkan_buffer& _buffer, u64 _size, VkBufferUsageFlags _usage, VkMemoryPropertyFlags _memory_properties, const ALLOCATION_POOL& _pool) {
 			VkBufferCreateInfo create_info = {};
 			create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
 			create_info.size = _size;
@@ -1302,16 +1959,12 @@ namespace Backend {
 				return false;
 			}
 
-			VkMemoryAllocateInfo alloc_info = { VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
-			alloc_info.allocationSize = mem_requirements.size;
-			alloc_info.memoryTypeIndex = mem_index;
-
-			if (vkAllocateMemory(device, &alloc_info, nullptr, &_buffer.memory) != VK_SUCCESS) {
+			if (!allocator.Allocate(mem_requirements, mem_index, true, _pool, _buffer.allocation)) {
 				LOG_ERROR("[vulkan] memory allocation");
 				return false;
 			}
 
-			if (vkBindBufferMemory(device, _buffer.buffer, _buffer.memory, 0) != VK_SUCCESS) {
+			if (vkBindBufferMemory(device, _buffer.buffer, _buffer.allocation.memory, _buffer.allocation.offset) != VK_SUCCESS) {
 				LOG_ERROR("[vulkan] binding memory buffer");
 				return false;
 			}
@@ -1320,85 +1973,266 @@ namespace Backend {
 
 		bool GraphicsVulkan::LoadBuffer(vulkan_buffer& _buffer, void* _data, size_t _size) {
 			if (resizableBar) {
-				void* data;
-				if (vkMapMemory(device, _buffer.memory, 0, _size, 0, &data) != VK_SUCCESS) {
+				if (_buffer.allocation.mapped == nullptr) {
+					LOG_ERROR("[vulkan] buffer memory not host visible");
 					return false;
 				}
-				memcpy(data, _data, _size);
+				memcpy(_buffer.allocation.mapped, _data, _size);
 			} else {
-				vulkan_buffer staging_buffer = {};
-				if (!InitBuffer(staging_buffer, _size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
-					LOG_ERROR("[vulkan] init staging buffer");
+				// copy gets recorded into the current upload batch, the batch is submitted together with the next frame
+				unique_lock<mutex> lock_upload(mutUpload);
+
+				VkDeviceSize offset = 0;
+				if (!AllocateUpload(_size, offset)) {
+					LOG_ERROR("[vulkan] allocate upload ring range");
 					return false;
 				}
-				void* data;
-				if (vkMapMemory(device, staging_buffer.memory, 0, _size, 0, &data) != VK_SUCCESS) {
-					LOG_ERROR("[vulkan] map memory for staging buffer");
+				memcpy((u8*)uploadRing.buffer.allocation.mapped + offset, _data, _size);
+
+				if (!BeginUploadBatch()) {
 					return false;
 				}
-				memcpy(data, _data, _size);
-				vkUnmapMemory(device, staging_buffer.memory);
+				VkBufferCopy region = { offset, 0, _size };
+				vkCmdCopyBuffer(uploadRing.batches[uploadRing.batch_index].command_buffer, uploadRing.buffer.buffer, _buffer.buffer, 1, &region);
+			}
+			return true;
+		}
+
+		bool GraphicsVulkan::InitUploadRing(const VkDeviceSize& _size) {
+			if (!InitBuffer(uploadRing.buffer, _size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
+				LOG_ERROR("[vulkan] init upload ring buffer");
+				return false;
+			}
+			if (uploadRing.buffer.allocation.mapped == nullptr) {
+				LOG_ERROR("[vulkan] upload ring buffer not mapped");
+				return false;
+			}
+			uploadRing.size = _size;
+			uploadRing.alignment = std::max((VkDeviceSize)16, physicalDeviceProperties.limits.optimalBufferCopyOffsetAlignment);
+			uploadRing.head = 0;
+			uploadRing.tail = 0;
+			uploadRing.batch_index = 0;
 
-				VkCommandPool cmd_pool;
-				VkCommandBuffer cmd_buffer;
+			for (auto& n : uploadRing.batches) {
+				if (n.command_pool != VK_NULL_HANDLE) { continue; }
 
 				VkCommandPoolCreateInfo create_info = { VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
 				create_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
 				create_info.queueFamilyIndex = familyIndex;
-				if (vkCreateCommandPool(device, &create_info, nullptr, &cmd_pool) != VK_SUCCESS) {
-					LOG_ERROR("[vulkan] init command pool for staging buffer");
+				if (vkCreateCommandPool(device, &create_info, nullptr, &n.command_pool) != VK_SUCCESS) {
+					LOG_ERROR("[vulkan] create command pool for upload batch");
 					return false;
 				}
 
 				VkCommandBufferAllocateInfo alloc_info = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
-				alloc_info.commandPool = cmd_pool;
+				alloc_info.commandPool = n.command_pool;
 				alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
 				alloc_info.commandBufferCount = 1;
-				if (vkAllocateCommandBuffers(device, &alloc_info, &cmd_buffer) != VK_SUCCESS) {
-					LOG_ERROR("[vulkan] allocate command buffer for staging buffer");
+				if (vkAllocateCommandBuffers(device, &alloc_info, &n.command_buffer) != VK_SUCCESS) {
+					LOG_ERROR("[vulkan] allocate command buffer for upload batch");
+					return false;
 				}
 
-				VkCommandBufferBeginInfo begin_info = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
-				begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-				if (vkBeginCommandBuffer(cmd_buffer, &begin_info) != VK_SUCCESS) {
-					LOG_ERROR("[vulkan] begin command buffer for staging buffer");
+				VkFenceCreateInfo fence_info = { VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
+				if (vkCreateFence(device, &fence_info, nullptr, &n.fence) != VK_SUCCESS) {
+					LOG_ERROR("[vulkan] create fence for upload batch");
 					return false;
 				}
-				{
-					VkBufferCopy region = { 0, 0, _size };
-					vkCmdCopyBuffer(cmd_buffer, staging_buffer.buffer, _buffer.buffer, 1, &region);
+			}
+
+			return true;
+		}
+
+		void GraphicsVulkan::DestroyUploadRing() {
+			unique_lock<mutex> lock_upload(mutUpload);
+
+			for (auto& n : uploadRing.batches) {
+				if (n.in_flight) {
+					vkWaitForFences(device, 1, &n.fence, VK_TRUE, UINT64_MAX);
 				}
-				if (vkEndCommandBuffer(cmd_buffer) != VK_SUCCESS) {
-					LOG_ERROR("[vulkan] end command buffer for staging buffer");
-					return false;
+				if (n.command_pool != VK_NULL_HANDLE) {
+					vkDestroyCommandPool(device, n.command_pool, nullptr);
+				}
+				if (n.fence != VK_NULL_HANDLE) {
+					vkDestroyFence(device, n.fence, nullptr);
+				}
+				n = {};
+			}
+			if (uploadRing.buffer.buffer != VK_NULL_HANDLE) {
+				DestroyBuffer(uploadRing.buffer);
+			}
+			uploadRing = {};
+		}
+
+		// expects mutUpload to be locked, only blocks when the ring is full
+		bool GraphicsVulkan::AllocateUpload(const VkDeviceSize& _size, VkDeviceSize& _offset) {
+			upload_ring& ring = uploadRing;
+			RetireUploadBatches(false);
+
+			while (true) {
+				VkDeviceSize offset = (ring.head + ring.alignment - 1) & ~(ring.alignment - 1);
+				if (ring.head >= ring.tail) {
+					if (offset + _size <= ring.size) {
+						_offset = offset;
+						break;
+					} else if (_size < ring.tail) {
+						_offset = 0;
+						break;
+					}
+				} else if (offset + _size < ring.tail) {
+					_offset = offset;
+					break;
 				}
 
-				VkSubmitInfo submit_info = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
-				submit_info.commandBufferCount = 1;
-				submit_info.pCommandBuffers = &cmd_buffer;
-				if (vkQueueSubmit(queue, 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS) {
-					LOG_ERROR("[vulkan] submit command buffer for staging buffer to queue");
-					return false;
+				// make room: oldest batch in flight first, then the one currently recording
+				if (RetireUploadBatches(true)) {
+					continue;
 				}
-				if (vkQueueWaitIdle(queue) != VK_SUCCESS) {
-					LOG_ERROR("[vulkan] process command buffer for staging buffer");
-					return false;
+				if (ring.batches[ring.batch_index].recording) {
+					SubmitUploadBatch();
+					continue;
+				}
+
+				// ring is empty, start over at the beginning before resizing
+				if (ring.head != 0) {
+					ring.head = 0;
+					ring.tail = 0;
+					continue;
 				}
 
-				vkDestroyCommandPool(device, cmd_pool, nullptr);
-				DestroyBuffer(staging_buffer);
+				// still too small -> replace it with a larger one
+				VkDeviceSize size = ring.size;
+				while (size < _size + ring.alignment) {
+					size *= 2;
+				}
+				LOG_WARN("[vulkan] upload of ", _size, " bytes exceeds upload ring, resizing to ", size, " bytes");
+				DestroyBuffer(ring.buffer);
+				if (!InitUploadRing(size)) {
+					return false;
+				}
 			}
+
+			ring.head = _offset + _size;
 			return true;
 		}
 
-		bool GraphicsVulkan::InitImage(vulkan_image& _image, u32 _width, u32 _height, VkFormat _format, VkImageUsageFlags _usage, VkImageTiling _tiling) {
-			VkImageCreateInfo image_info = { VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
-			image_info.imageType = VK_IMAGE_TYPE_2D;
-			image_info.extent.width = _width;
+		bool GraphicsVulkan::BeginUploadBatch() {
+			upload_batch& batch = uploadRing.batches[uploadRing.batch_index];
+			if (batch.recording) { return true; }
+
+			// the slot is the oldest one in flight
+			if (batch.in_flight) {
+				RetireUploadBatches(true);
+			}
+
+			if (vkResetCommandPool(device, batch.command_pool, 0) != VK_SUCCESS) {
+				LOG_ERROR("[vulkan] reset command pool for upload batch");
+			}
+
+			VkCommandBufferBeginInfo begin_info = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+			begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+			if (vkBeginCommandBuffer(batch.command_buffer, &begin_info) != VK_SUCCESS) {
+				LOG_ERROR("[vulkan] begin command buffer for upload batch");
+				return false;
+			}
+
+			// frames submitted earlier may still read the buffers the copies overwrite
+			vkCmdPipelineBarrier(batch.command_buffer,
+				VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+				VK_PIPELINE_STAGE_TRANSFER_BIT,
+				0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+			batch.recording = true;
+			return true;
+		}
+
+		// expects mutUpload to be locked
+		void GraphicsVulkan::SubmitUploadBatch() {
+			upload_batch& batch = uploadRing.batches[uploadRing.batch_index];
+			if (!batch.recording) { return; }
+
+			// make copies visible to everything consuming buffers in later submits
+			VkMemoryBarrier barrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+			vkCmdPipelineBarrier(batch.command_buffer,
+				VK_PIPELINE_STAGE_TRANSFER_BIT,
+				VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+				0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+			if (vkEndCommandBuffer(batch.command_buffer) != VK_SUCCESS) {
+				LOG_ERROR("[vulkan] end command buffer for upload batch");
+			}
+			batch.recording = false;
+
+			if (vkResetFences(device, 1, &batch.fence) != VK_SUCCESS) {
+				LOG_ERROR("[vulkan] reset fence for upload batch");
+			}
+
+			VkSubmitInfo submit_info = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
+			submit_info.commandBufferCount = 1;
+			submit_info.pCommandBuffers = &batch.command_buffer;
+			{
+				unique_lock<mutex> lock_queue(mutQueue);
+				if (vkQueueSubmit(queue, 1, &submit_info, batch.fence) != VK_SUCCESS) {
+					LOG_ERROR("[vulkan] submit upload batch");
+					return;
+				}
+			}
+			batch.end = uploadRing.head;
+			batch.in_flight = true;
+
+			++uploadRing.batch_index %= (int)uploadRing.batches.size();
+		}
+
+		// expects mutUpload to be locked, frees ring ranges of finished batches in submission order
+		bool GraphicsVulkan::RetireUploadBatches(const bool& _wait_oldest) {
+			upload_ring& ring = uploadRing;
+			bool retired = false;
+			int count = (int)ring.batches.size();
+
+			for (int i = 0; i < count; i++) {
+				upload_batch& batch = ring.batches[(ring.batch_index + i) % count];
+				if (!batch.in_flight) { continue; }
+
+				if (_wait_oldest && !retired) {
+					if (vkWaitForFences(device, 1, &batch.fence, VK_TRUE, UINT64_MAX) != VK_SUCCESS) {
+						LOG_ERROR("[vulkan] wait for upload batch");
+						break;
+					}
+				} else if (vkGetFenceStatus(device, batch.fence) != VK_SUCCESS) {
+					break;
+				}
+
+				ring.tail = batch.end;
+				batch.in_flight = false;
+				retired = true;
+			}
+
+			// nothing alive -> start over at the beginning
+			if (retired && ring.head == ring.tail && !ring.batches[ring.batch_index].recording) {
+				ring.head = 0;
+				ring.tail = 0;
+			}
+			return retired;
+		}
+
+		void GraphicsVulkan::FlushUploads() {
+			unique_lock<mutex> lock_upload(mutUpload);
+			if (uploadRing.buffer.buffer == VK_NULL_HANDLE) { return; }
+
+			SubmitUploadBatch();
+			RetireUploadBatches(false);
+		}
+
+		bool GraphicsVulkan::InitImage(vulkan_image& _image, u32 _width, u32 _height, VkFormat _format, VkImageUsageFlags _usage, VkImageTiling _tiling, const u32& _layers) {
+			VkImageCreateInfo image_info = { VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
+			image_info.imageType = VK_IMAGE_TYPE_2D;
+			image_info.extent.width = _width;
 			image_info.extent.height = _height;
 			image_info.extent.depth = 1;
 			image_info.mipLevels = 1;
-			image_info.arrayLayers = 1;
+			image_info.arrayLayers = _layers;
 			image_info.format = _format;
 			image_info.tiling = _tiling;
 			image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -1412,23 +2246,22 @@ namespace Backend {
 
 			VkMemoryRequirements mem_requ;
 			vkGetImageMemoryRequirements(device, _image.image, &mem_requ);
-			VkMemoryAllocateInfo alloc_info = { VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
-			alloc_info.allocationSize = mem_requ.size;
-			alloc_info.memoryTypeIndex = FindMemoryTypes(mem_requ.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-			if (vkAllocateMemory(device, &alloc_info, nullptr, &_image.memory) != VK_SUCCESS) {
+			u32 mem_index = FindMemoryTypes(mem_requ.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+			if (mem_index == UINT32_MAX || !allocator.Allocate(mem_requ, mem_index, _tiling == VK_IMAGE_TILING_LINEAR, POOL_FREE_LIST, _image.allocation)) {
 				LOG_ERROR("[vulkan] allocate image memory");
+				return false;
 			}
-			if (vkBindImageMemory(device, _image.image, _image.memory, 0) != VK_SUCCESS) {
+			if (vkBindImageMemory(device, _image.image, _image.allocation.memory, _image.allocation.offset) != VK_SUCCESS) {
 				LOG_ERROR("[vulkan] bind image memory");
 			}
 
 			VkImageViewCreateInfo create_info = { VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
 			create_info.image = _image.image;
-			create_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			create_info.viewType = _layers > 1 ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D;
 			create_info.format = _format;
 			create_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 			create_info.subresourceRange.levelCount = 1;
-			create_info.subresourceRange.layerCount = 1;
+			create_info.subresourceRange.layerCount = _layers;
 			if (vkCreateImageView(device, &create_info, nullptr, &_image.image_view) != VK_SUCCESS) {
 				LOG_ERROR("[vulkan] create image view");
 				return false;
@@ -1437,32 +2270,99 @@ namespace Backend {
 			return true;
 		}
 
+		// expects mutQueue to be locked, no device wide wait: the old swapchain gets handed to the driver as oldSwapchain
+		// (images can be reused) and its resources retire until the frames in flight that used them completed
 		void GraphicsVulkan::RebuildSwapchain() {
-			WaitIdle();
+			pendingPresents.clear();
+			DestroyRetiredSwapchains(false);
+
+			retired_swapchain retired = {};
+			retired.swapchain = swapchain;
+			retired.image_views.swap(imageViews);
+			retired.frame_buffers.swap(frameBuffers);
+			retired.static_command_buffers.swap(staticCommandBuffers);
+			for (int i = 0; i < FRAMES_IN_FLIGHT; i++) {
+				retired.frame_serials[i] = frameSerials[i];
+				retired.present_serials[i] = presentSerials[i];
+			}
+			retired.retire_serial = submitSerial;
+			retiredSwapchains.emplace_back(std::move(retired));
 
-			DestroyFrameBuffers();
-			//DestroyRenderPass();
-	
+			// retired by the driver even if the creation fails
 			oldSwapchain = swapchain;
-			InitSwapchain(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT);
-			DestroySwapchain(true);
+			swapchain = VK_NULL_HANDLE;
+			if (!InitSwapchain(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT)) {
+				LOG_ERROR("[vulkan] rebuild swapchain");
+			}
+			oldSwapchain = VK_NULL_HANDLE;
 
-			//InitRenderPass();
 			InitFrameBuffers();
 		}
 
-		void GraphicsVulkan::DestroySwapchain(const bool& _rebuild) {
-			WaitIdle();
-			if (_rebuild) {
-				vkDestroySwapchainKHR(device, oldSwapchain, nullptr);
-			} else {
-				for (auto& n : imageViews) {
+		// a frame in flight is done with the retired resources once its fence signaled or it got reused for a later submit
+		// (RenderFrame waits for the fence before reusing it). The render fences don't cover the presentation engine:
+		// with present fences the same applies to the presents, otherwise every frame in flight has to complete a frame
+		// on the new swapchain first (at least FRAMES_IN_FLIGHT + 1 submits), the old images are released by then
+		bool GraphicsVulkan::RetiredSwapchainInUse(const retired_swapchain& _retired) {
+			for (int i = 0; i < FRAMES_IN_FLIGHT; i++) {
+				if (_retired.frame_serials[i] != 0 && frameSerials[i] == _retired.frame_serials[i] && vkGetFenceStatus(device, renderFences[i]) != VK_SUCCESS) { return true; }
+			}
+
+			if (swapchainMaintenance) {
+				for (int i = 0; i < FRAMES_IN_FLIGHT; i++) {
+					if (_retired.present_serials[i] != 0 && presentSerials[i] == _retired.present_serials[i] && vkGetFenceStatus(device, presentFences[i]) != VK_SUCCESS) { return true; }
+				}
+				return false;
+			}
+
+			if (submitSerial <= _retired.retire_serial + FRAMES_IN_FLIGHT) { return true; }
+			for (u32 i = 0; i < framesInFlight; i++) {
+				if (frameSerials[i] <= _retired.retire_serial || vkGetFenceStatus(device, renderFences[i]) != VK_SUCCESS) { return true; }
+			}
+			return false;
+		}
+
+		void GraphicsVulkan::DestroyRetiredSwapchains(const bool& _all) {
+			for (auto it = retiredSwapchains.begin(); it != retiredSwapchains.end();) {
+				if (!_all && RetiredSwapchainInUse(*it)) {
+					++it;
+					continue;
+				}
+
+				if (!it->static_command_buffers.empty()) {
+					vkFreeCommandBuffers(device, staticCommandPool, (u32)it->static_command_buffers.size(), it->static_command_buffers.data());
+				}
+				for (auto& n : it->frame_buffers) {
+					vkDestroyFramebuffer(device, n, nullptr);
+				}
+				for (auto& n : it->image_views) {
 					vkDestroyImageView(device, n, nullptr);
 				}
-				vkDestroySwapchainKHR(device, swapchain, nullptr);
+				vkDestroySwapchainKHR(device, it->swapchain, nullptr);
+				it = retiredSwapchains.erase(it);
 			}
 		}
 
+		void GraphicsVulkan::DestroySwapchain() {
+			WaitIdle();
+			// not covered by the device wait
+			if (swapchainMaintenance) {
+				for (int i = 0; i < FRAMES_IN_FLIGHT; i++) {
+					if (presentSerials[i] != 0 && vkWaitForFences(device, 1, &presentFences[i], VK_TRUE, UINT64_MAX) != VK_SUCCESS) {
+						LOG_ERROR("[vulkan] wait for present fence");
+					}
+					presentSerials[i] = 0;
+				}
+			}
+			DestroyRetiredSwapchains(true);
+			for (auto& n : imageViews) {
+				vkDestroyImageView(device, n, nullptr);
+			}
+			imageViews.clear();
+			vkDestroySwapchainKHR(device, swapchain, nullptr);
+			swapchain = VK_NULL_HANDLE;
+		}
+
 		void GraphicsVulkan::DestroySurface() {
 			WaitIdle();
 			vkDestroySurfaceKHR(vulkanInstance, surface, nullptr);
@@ -1486,9 +2386,19 @@ namespace Backend {
 			for (int i = 0; i < FRAMES_IN_FLIGHT; i++) {
 				vkDestroyCommandPool(device, commandPools[i], nullptr);
 			}
+			vkDestroyCommandPool(device, staticCommandPool, nullptr);
+			staticCommandPool = VK_NULL_HANDLE;
+			staticCommandBuffers.clear();
+			// freed together with the pool
+			for (auto& n : retiredSwapchains) {
+				n.static_command_buffers.clear();
+			}
 			for (auto& n : renderFences) {
 				vkDestroyFence(device, n, nullptr);
 			}
+			for (auto& n : presentFences) {
+				vkDestroyFence(device, n, nullptr);
+			}
 
 			for (auto& n : acquireSemaphores) {
 				DestroySemaphore(n);
@@ -1516,14 +2426,14 @@ namespace Backend {
 		void GraphicsVulkan::DestroyBuffer(vulkan_buffer& _buffer) {
 			WaitIdle();
 			vkDestroyBuffer(device, _buffer.buffer, nullptr);
-			vkFreeMemory(device, _buffer.memory, nullptr);
+			allocator.Free(_buffer.allocation);
 		}
 
 		void GraphicsVulkan::DestroyImage(vulkan_image& _image) {
 			WaitIdle();
 			vkDestroyImageView(device, _image.image_view, nullptr);
 			vkDestroyImage(device, _image.image, nullptr);
-			vkFreeMemory(device, _image.memory, nullptr);
+			allocator.Free(_image.allocation);
 		}
 
 		void GraphicsVulkan::DestroySemaphore(VkSemaphore& _semaphore) {
@@ -1552,6 +2462,67 @@ namespace Backend {
 			return true;
 		}
 
+		// no layers given -> single fullscreen layer from the legacy fields
+		bool GraphicsVulkan::InitTex2dLayers() {
+			tex2dData.layers.clear();
+			if (virtGraphicsInfo.layers.empty()) {
+				tex2d_layer layer = {};
+				layer.info.image_data = virtGraphicsInfo.image_data;
+				layer.info.mailbox = virtGraphicsInfo.mailbox;
+				layer.info.lcd_width = virtGraphicsInfo.lcd_width;
+				layer.info.lcd_height = virtGraphicsInfo.lcd_height;
+				layer.info.aspect_ratio = virtGraphicsInfo.aspect_ratio;
+				tex2dData.layers.emplace_back(layer);
+			} else {
+				if (virtGraphicsInfo.layers.size() > TEX2D_LAYERS_MAX) {
+					LOG_WARN("[vulkan] ", virtGraphicsInfo.layers.size(), " layers requested, only ", TEX2D_LAYERS_MAX, " supported");
+				}
+				for (size_t i = 0; i < std::min(virtGraphicsInfo.layers.size(), (size_t)TEX2D_LAYERS_MAX); i++) {
+					tex2d_layer layer = {};
+					layer.info = virtGraphicsInfo.layers[i];
+					tex2dData.layers.emplace_back(layer);
+				}
+			}
+			tex2dData.layered = tex2dData.layers.size() > 1;
+
+			tex2dData.width = 0;
+			tex2dData.height = 0;
+			tex2dData.size = 0;
+			for (auto& n : tex2dData.layers) {
+				if (n.info.lcd_width == 0 || n.info.lcd_height == 0 || n.info.width <= 0.f || n.info.height <= 0.f) {
+					LOG_ERROR("[vulkan] invalid tex2d layer size");
+					return false;
+				}
+				tex2dData.width = std::max(tex2dData.width, n.info.lcd_width);
+				tex2dData.height = std::max(tex2dData.height, n.info.lcd_height);
+
+				n.offset = tex2dData.size;
+				n.size = (u64)n.info.lcd_width * n.info.lcd_height * TEX2D_CHANNELS;
+				tex2dData.size += n.size;
+			}
+
+			// smaller layers only use the top left part of their array layer
+			for (auto& n : tex2dData.layers) {
+				n.uv_scale = glm::vec4((float)n.info.lcd_width / tex2dData.width, (float)n.info.lcd_height / tex2dData.height, 0.f, 0.f);
+			}
+
+			return true;
+		}
+
+		// GLSL embedded in the sources, the file name selects the stage and the cache entry
+		bool GraphicsVulkan::CompileEmbeddedShader(const std::string& _file_name, const char* _source, std::vector<char>& _byte_code) {
+			shaderc_compiler_t compiler = shaderc_compiler_initialize();
+			shaderc_compile_options_t options = shaderc_compile_options_initialize();
+			u64 cache_key = init_compile_options(options);
+
+			auto source = vector<char>(_source, _source + strlen(_source));
+			bool compiled = compile_shader_source(_byte_code, source, _file_name, compiler, options, shaderFolder + SHADER_CACHE, cache_key);
+
+			shaderc_compiler_release(compiler);
+			shaderc_compile_options_release(options);
+			return compiled;
+		}
+
 		bool GraphicsVulkan::InitTex2dDescriptorSets() {
 			{
 				VkDescriptorPoolSize poolSizes[] = {
@@ -1588,25 +2559,37 @@ namespace Backend {
 					LOG_ERROR("[vulkan] allocate descriptor sets");
 					return false;
 				}
-
-				// info for descriptor of texture2d to sample from -> fragment shader
-				VkDescriptorImageInfo imageInfo = { tex2dData.sampler, tex2dData.image.image_view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
-				auto descriptorWrites = std::vector<VkWriteDescriptorSet>(1);
-				descriptorWrites[0] = { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
-				descriptorWrites[0].dstSet = tex2dData.descriptor_set;
-				descriptorWrites[0].dstBinding = 0;
-				descriptorWrites[0].descriptorCount = 1;
-				descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-				descriptorWrites[0].pImageInfo = &imageInfo;
-				vkUpdateDescriptorSets(device, (u32)descriptorWrites.size(), descriptorWrites.data(), 0, nullptr);
 			}
 
+			WriteTex2dDescriptorSet();
+
 			return true;
 		}
 
+		// not allowed while command buffers binding the set are pending
+		void GraphicsVulkan::WriteTex2dDescriptorSet() {
+			// info for descriptor of texture2d to sample from -> fragment shader, output of the upscale chain if present
+			// (linear sampling of the upscaled image unless the last pass is plain integer scaling)
+			VkDescriptorImageInfo imageInfo = { tex2dData.sampler, tex2dData.image.image_view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+			if (!upscaleData.stages.empty()) {
+				const auto& last = upscaleData.stages.back();
+				imageInfo.imageView = last.image.image_view;
+				imageInfo.sampler = last.pass.filter == UPSCALE_INTEGER ? tex2dData.sampler : upscaleData.linear_sampler;
+			}
+			auto descriptorWrites = std::vector<VkWriteDescriptorSet>(1);
+			descriptorWrites[0] = { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
+			descriptorWrites[0].dstSet = tex2dData.descriptor_set;
+			descriptorWrites[0].dstBinding = 0;
+			descriptorWrites[0].descriptorCount = 1;
+			descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			descriptorWrites[0].pImageInfo = &imageInfo;
+			vkUpdateDescriptorSets(device, (u32)descriptorWrites.size(), descriptorWrites.data(), 0, nullptr);
+
+			staticCommandsDirty = true;
+		}
+
 		bool GraphicsVulkan::InitTex2dBuffers() {
-			// staging buffer for texture upload
-			tex2dData.size = virtGraphicsInfo.lcd_width * virtGraphicsInfo.lcd_height * TEX2D_CHANNELS;
+			// staging buffer for texture upload (all layers back to back)
 			for (int i = 0; i < FRAMES_IN_FLIGHT_2D; i++) {
 				tex2dData.staging_buffer.emplace_back();
 				if (!InitBuffer(tex2dData.staging_buffer[i], tex2dData.size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
@@ -1616,14 +2599,16 @@ namespace Backend {
 			}
 
 			// image buffer for shader usage
-			if (!InitImage(tex2dData.image, virtGraphicsInfo.lcd_width, virtGraphicsInfo.lcd_height, tex2dData.format, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, /*resizableBar ? VK_IMAGE_TILING_LINEAR :*/ VK_IMAGE_TILING_OPTIMAL)) {
+			if (!InitImage(tex2dData.image, tex2dData.width, tex2dData.height, tex2dData.format, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, /*resizableBar ? VK_IMAGE_TILING_LINEAR :*/ VK_IMAGE_TILING_OPTIMAL, (u32)tex2dData.layers.size())) {
 				LOG_ERROR("[vulkan] create target 2d texture for virtual hardware");
 				return false;
 			}
 
+			// staging buffers live in persistently mapped memory
 			tex2dData.mapped_image_data = std::vector<void*>(FRAMES_IN_FLIGHT_2D);
 			for (int i = 0; auto & n : tex2dData.staging_buffer) {
-				if (vkMapMemory(device, n.memory, 0, tex2dData.size, 0, &tex2dData.mapped_image_data[i]) != VK_SUCCESS) {
+				tex2dData.mapped_image_data[i] = n.allocation.mapped;
+				if (tex2dData.mapped_image_data[i] == nullptr) {
 					LOG_ERROR("[vulkan] map image memory");
 					return false;
 				}
@@ -1642,8 +2627,18 @@ namespace Backend {
 			VkShaderModule vertex_shader;
 			VkShaderModule fragment_shader;
 
-			auto vertex_shader_data = vector<char>(tex2dVertShader.data(), tex2dVertShader.data() + tex2dVertShader.size());
-			auto fragment_shader_data = vector<char>(tex2dFragShader.data(), tex2dFragShader.data() + tex2dFragShader.size());
+			auto vertex_shader_data = vector<char>();
+			auto fragment_shader_data = vector<char>();
+			if (tex2dData.layered) {
+				if (!CompileEmbeddedShader(TEX2D_LAYERS_VERT_NAME, TEX2D_LAYERS_VERT_SOURCE, vertex_shader_data) ||
+					!CompileEmbeddedShader(TEX2D_LAYERS_FRAG_NAME, TEX2D_LAYERS_FRAG_SOURCE, fragment_shader_data)) {
+					LOG_ERROR("[vulkan] compile tex2d layer shaders");
+					return false;
+				}
+			} else {
+				vertex_shader_data = vector<char>(tex2dVertShader.data(), tex2dVertShader.data() + tex2dVertShader.size());
+				fragment_shader_data = vector<char>(tex2dFragShader.data(), tex2dFragShader.data() + tex2dFragShader.size());
+			}
 
 			if (InitShaderModule(vertex_shader_data, vertex_shader) && InitShaderModule(fragment_shader_data, fragment_shader)) {
 				VulkanPipelineBufferInfo buffer_info = {};
@@ -1666,7 +2661,7 @@ namespace Backend {
 
 				auto push_constants = vector<VkPushConstantRange>(1);
 				push_constants[0].offset = 0;
-				push_constants[0].size = sizeof(glm::mat4);
+				push_constants[0].size = tex2dData.layered ? sizeof(tex2d_layer_push_constants) : sizeof(glm::mat4);
 				push_constants[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 
 				InitPipeline(vertex_shader, fragment_shader, tex2dData.pipeline_layout, tex2dData.pipeline, buffer_info, tex2dData.descriptor_set_layout, push_constants);
@@ -1683,6 +2678,395 @@ namespace Backend {
 			vkDestroyPipelineLayout(device, tex2dData.pipeline_layout, nullptr);
 		}
 
+		/* *************************************************************************************************
+			COMPUTE UPSCALE CHAIN
+		************************************************************************************************* */
+		void GraphicsVulkan::SetUpscaleChain(const std::vector<upscale_pass>& _passes) {
+			upscaleData.passes = _passes;
+			upscaleData.changed = true;
+		}
+
+		// builds the stages for the requested passes, on failure the texture gets presented directly
+		bool GraphicsVulkan::InitUpscaleChain() {
+			if (upscaleData.passes.empty()) { return true; }
+
+			if (tex2dData.layered) {
+				LOG_WARN("[vulkan] upscale chain: not supported with multiple layers");
+				return false;
+			}
+
+			if (!computeSupported) {
+				LOG_WARN("[vulkan] upscale chain: queue doesn't support compute");
+				return false;
+			}
+
+			// shared objects, created once
+			if (upscaleData.descriptor_set_layout == VK_NULL_HANDLE) {
+				VkDescriptorSetLayoutBinding bindings[] = {
+					{0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+					{1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+				};
+				VkDescriptorSetLayoutCreateInfo layout_info = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
+				layout_info.bindingCount = sizeof(bindings) / sizeof(bindings[0]);
+				layout_info.pBindings = bindings;
+				if (vkCreateDescriptorSetLayout(device, &layout_info, nullptr, &upscaleData.descriptor_set_layout) != VK_SUCCESS) {
+					LOG_ERROR("[vulkan] upscale chain: create descriptor set layout");
+					return false;
+				}
+
+				VkPushConstantRange push_constant = { VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(upscale_push_constants) };
+				VkPipelineLayoutCreateInfo pipeline_layout_info = { VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO };
+				pipeline_layout_info.setLayoutCount = 1;
+				pipeline_layout_info.pSetLayouts = &upscaleData.descriptor_set_layout;
+				pipeline_layout_info.pushConstantRangeCount = 1;
+				pipeline_layout_info.pPushConstantRanges = &push_constant;
+				if (vkCreatePipelineLayout(device, &pipeline_layout_info, nullptr, &upscaleData.pipeline_layout) != VK_SUCCESS) {
+					LOG_ERROR("[vulkan] upscale chain: create pipeline layout");
+					return false;
+				}
+
+				VkSamplerCreateInfo sampler_info = { VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO };
+				sampler_info.magFilter = VK_FILTER_LINEAR;
+				sampler_info.minFilter = VK_FILTER_LINEAR;
+				sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+				sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+				sampler_info.addressModeV = sampler_info.addressModeU;
+				sampler_info.addressModeW = sampler_info.addressModeU;
+				sampler_info.maxAnisotropy = 1.f;
+				if (vkCreateSampler(device, &sampler_info, nullptr, &upscaleData.linear_sampler) != VK_SUCCESS) {
+					LOG_ERROR("[vulkan] upscale chain: create sampler");
+					return false;
+				}
+			}
+
+			{
+				u32 pass_num = (u32)upscaleData.passes.size();
+				VkDescriptorPoolSize pool_sizes[] = {
+					{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, pass_num},
+					{VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, pass_num},
+				};
+				VkDescriptorPoolCreateInfo pool_info = { VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+				pool_info.maxSets = pass_num;
+				pool_info.poolSizeCount = sizeof(pool_sizes) / sizeof(pool_sizes[0]);
+				pool_info.pPoolSizes = pool_sizes;
+				if (vkCreateDescriptorPool(device, &pool_info, nullptr, &upscaleData.descriptor_pool) != VK_SUCCESS) {
+					LOG_ERROR("[vulkan] upscale chain: create descriptor pool");
+					return false;
+				}
+			}
+
+			u32 width = tex2dData.width;
+			u32 height = tex2dData.height;
+			const u32 max_size = physicalDeviceProperties.limits.maxImageDimension2D;
+
+			for (const auto& n : upscaleData.passes) {
+				if (n.filter >= UPSCALE_FILTER_NUM || !InitUpscalePipeline(n.filter)) {
+					DestroyUpscaleChain(false);
+					return false;
+				}
+
+				upscale_stage stage = {};
+				stage.pass = n;
+				stage.pass.scale = std::max(n.scale, 1u);
+				while (stage.pass.scale > 1 && (width * stage.pass.scale > max_size || height * stage.pass.scale > max_size)) {
+					stage.pass.scale--;
+				}
+				stage.width = width * stage.pass.scale;
+				stage.height = height * stage.pass.scale;
+
+				if (!InitImage(stage.image, stage.width, stage.height, tex2dData.format, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_TILING_OPTIMAL)) {
+					LOG_ERROR("[vulkan] upscale chain: create image ", stage.width, "x", stage.height);
+					DestroyUpscaleChain(false);
+					return false;
+				}
+
+				VkDescriptorSetAllocateInfo allocate_info = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+				allocate_info.descriptorPool = upscaleData.descriptor_pool;
+				allocate_info.descriptorSetCount = 1;
+				allocate_info.pSetLayouts = &upscaleData.descriptor_set_layout;
+				if (vkAllocateDescriptorSets(device, &allocate_info, &stage.descriptor_set) != VK_SUCCESS) {
+					LOG_ERROR("[vulkan] upscale chain: allocate descriptor set");
+					DestroyImage(stage.image);
+					DestroyUpscaleChain(false);
+					return false;
+				}
+
+				// input: previous stage (or the texture itself), sharp bilinear relies on the linear sampler
+				const VkImageView src_view = upscaleData.stages.empty() ? tex2dData.image.image_view : upscaleData.stages.back().image.image_view;
+				VkDescriptorImageInfo src_info = { n.filter == UPSCALE_SHARP_BILINEAR ? upscaleData.linear_sampler : tex2dData.sampler, src_view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+				VkDescriptorImageInfo dst_info = { VK_NULL_HANDLE, stage.image.image_view, VK_IMAGE_LAYOUT_GENERAL };
+
+				VkWriteDescriptorSet writes[2] = { { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET }, { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET } };
+				writes[0].dstSet = stage.descriptor_set;
+				writes[0].dstBinding = 0;
+				writes[0].descriptorCount = 1;
+				writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+				writes[0].pImageInfo = &src_info;
+				writes[1].dstSet = stage.descriptor_set;
+				writes[1].dstBinding = 1;
+				writes[1].descriptorCount = 1;
+				writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+				writes[1].pImageInfo = &dst_info;
+				vkUpdateDescriptorSets(device, 2, writes, 0, nullptr);
+
+				width = stage.width;
+				height = stage.height;
+				upscaleData.stages.emplace_back(stage);
+			}
+
+			LOG_INFO("[vulkan] upscale chain: ", upscaleData.stages.size(), " pass(es), ", tex2dData.width, "x", tex2dData.height, " -> ", width, "x", height);
+			return true;
+		}
+
+		// expects the GPU to be idle, pipelines and shared objects only get destroyed with _pipelines set
+		void GraphicsVulkan::DestroyUpscaleChain(const bool& _pipelines) {
+			for (auto& n : upscaleData.stages) {
+				DestroyImage(n.image);
+			}
+			upscaleData.stages.clear();
+
+			if (upscaleData.descriptor_pool != VK_NULL_HANDLE) {
+				vkDestroyDescriptorPool(device, upscaleData.descriptor_pool, nullptr);
+				upscaleData.descriptor_pool = VK_NULL_HANDLE;
+			}
+
+			if (_pipelines) {
+				for (auto& n : upscaleData.pipelines) {
+					vkDestroyPipeline(device, n, nullptr);
+					n = VK_NULL_HANDLE;
+				}
+				vkDestroyPipelineLayout(device, upscaleData.pipeline_layout, nullptr);
+				vkDestroyDescriptorSetLayout(device, upscaleData.descriptor_set_layout, nullptr);
+				vkDestroySampler(device, upscaleData.linear_sampler, nullptr);
+				upscaleData.pipeline_layout = VK_NULL_HANDLE;
+				upscaleData.descriptor_set_layout = VK_NULL_HANDLE;
+				upscaleData.linear_sampler = VK_NULL_HANDLE;
+			}
+		}
+
+		// compiled through shaderc like the enumerated shaders, the shader cache makes this cheap after the first run
+		bool GraphicsVulkan::InitUpscalePipeline(const UPSCALE_FILTER& _filter) {
+			if (upscaleData.pipelines[_filter] != VK_NULL_HANDLE) { return true; }
+
+			const upscale_shader& shader = UPSCALE_SHADERS[_filter];
+
+			const string full_source = string(UPSCALE_SHADER_HEADER) + shader.source;
+			auto byte_code = vector<char>();
+			bool compiled = CompileEmbeddedShader(shader.name, full_source.c_str(), byte_code);
+
+			VkShaderModule shader_module;
+			if (!compiled || !InitShaderModule(byte_code, shader_module)) {
+				LOG_ERROR("[vulkan] upscale chain: ", shader.name);
+				return false;
+			}
+
+			VkComputePipelineCreateInfo pipeline_info = { VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO };
+			pipeline_info.stage = { VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO };
+			pipeline_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+			pipeline_info.stage.module = shader_module;
+			pipeline_info.stage.pName = "main";
+			pipeline_info.layout = upscaleData.pipeline_layout;
+			VkResult result = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &upscaleData.pipelines[_filter]);
+			vkDestroyShaderModule(device, shader_module, nullptr);
+
+			if (result != VK_SUCCESS) {
+				LOG_ERROR("[vulkan] upscale chain: create compute pipeline ", shader.name);
+				upscaleData.pipelines[_filter] = VK_NULL_HANDLE;
+				return false;
+			}
+			return true;
+		}
+
+		// records after the texture upload, every stage ends up in SHADER_READ_ONLY_OPTIMAL for the next stage/the fragment shader
+		void GraphicsVulkan::RecordUpscaleChain(VkCommandBuffer& _command_buffer) {
+			u32 src_width = tex2dData.width;
+			u32 src_height = tex2dData.height;
+
+			for (size_t i = 0; i < upscaleData.stages.size(); i++) {
+				const auto& stage = upscaleData.stages[i];
+				const bool last = i + 1 == upscaleData.stages.size();
+
+				// content gets overwritten completely, only wait for the reads of the previous frame
+				ImageBarrier(_command_buffer, stage.image.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
+					last ? VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT_KHR : VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR, VK_ACCESS_2_NONE_KHR,
+					VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT_KHR);
+
+				upscale_push_constants params = { { (i32)src_width, (i32)src_height }, { (i32)stage.width, (i32)stage.height }, stage.pass.strength };
+				vkCmdBindPipeline(_command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, upscaleData.pipelines[stage.pass.filter]);
+				vkCmdBindDescriptorSets(_command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, upscaleData.pipeline_layout, 0, 1, &stage.descriptor_set, 0, nullptr);
+				vkCmdPushConstants(_command_buffer, upscaleData.pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(params), &params);
+				vkCmdDispatch(_command_buffer, (stage.width + 7) / 8, (stage.height + 7) / 8, 1);
+
+				ImageBarrier(_command_buffer, stage.image.image, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+					VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT_KHR,
+					last ? VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT_KHR : VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT_KHR, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT_KHR);
+
+				src_width = stage.width;
+				src_height = stage.height;
+			}
+		}
+
+		bool GraphicsVulkan::InitOffscreenTargets() {
+			swapchainFormat = VK_FORMAT_R8G8B8A8_UNORM;
+			if (win_width == 0 || win_height == 0) {
+				LOG_ERROR("[vulkan] headless: invalid render target size ", win_width, "x", win_height);
+				return false;
+			}
+
+			// one render target per frame in flight, they take the place of the swapchain images
+			offscreenTargets = std::vector<vulkan_image>(FRAMES_IN_FLIGHT);
+			images.clear();
+			imageViews.clear();
+			for (auto& n : offscreenTargets) {
+				if (!InitImage(n, win_width, win_height, swapchainFormat, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_IMAGE_TILING_OPTIMAL)) {
+					LOG_ERROR("[vulkan] headless: init render target");
+					return false;
+				}
+				images.emplace_back(n.image);
+				imageViews.emplace_back(n.image_view);
+			}
+
+			// host cached memory if available, the CPU reads every frame
+			VkMemoryPropertyFlags readback_flags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+			for (u32 i = 0; i < devMemProps.memoryTypeCount; i++) {
+				VkMemoryPropertyFlags flags = readback_flags | VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+				if ((devMemProps.memoryTypes[i].propertyFlags & flags) == flags) {
+					readback_flags = flags;
+					break;
+				}
+			}
+
+			for (auto& n : readbackBuffers) {
+				if (!InitBuffer(n, (u64)win_width * win_height * TEX2D_CHANNELS, VK_BUFFER_USAGE_TRANSFER_DST_BIT, readback_flags)) {
+					LOG_ERROR("[vulkan] headless: init readback buffer");
+					return false;
+				}
+			}
+			for (auto& n : readbackFrames) {
+				n = 0;
+			}
+
+			viewport = { .0f, .0f, (float)win_width, (float)win_height, .0f, 1.f };
+			scissor = { {0, 0}, {win_width, win_height} };
+			aspectRatio = (float)win_width / win_height;
+
+			LOG_INFO("[vulkan] headless: rendering offscreen (", win_width, "x", win_height, ")");
+			return true;
+		}
+
+		void GraphicsVulkan::DestroyOffscreenTargets() {
+			WaitIdle();
+			for (auto& n : offscreenTargets) {
+				DestroyImage(n);
+			}
+			offscreenTargets.clear();
+			images.clear();
+			imageViews.clear();
+
+			for (auto& n : readbackBuffers) {
+				if (n.buffer != VK_NULL_HANDLE) {
+					DestroyBuffer(n);
+				}
+				n = {};
+			}
+		}
+
+		void GraphicsVulkan::RecordReadback(VkCommandBuffer& _command_buffer, const u32& _index) {
+			// render pass leaves the target in TRANSFER_SRC_OPTIMAL, only the color writes need to be made available
+			VkMemoryBarrier barrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+			barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+			vkCmdPipelineBarrier(_command_buffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+			VkBufferImageCopy region = {};
+			region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			region.imageSubresource.layerCount = 1;
+			region.imageExtent = { win_width, win_height, 1 };
+			vkCmdCopyImageToBuffer(_command_buffer, offscreenTargets[_index].image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readbackBuffers[_index].buffer, 1, &region);
+
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+			vkCmdPipelineBarrier(_command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+		}
+
+		// has to be called from the render thread, doesn't wait for the GPU
+		bool GraphicsVulkan::ReadbackFrame(std::vector<u8>& _data, u32& _width, u32& _height) {
+			if (!headless) { return false; }
+
+			int index = -1;
+			for (int i = 0; i < FRAMES_IN_FLIGHT; i++) {
+				if (readbackFrames[i] == 0 || (index > -1 && readbackFrames[i] < readbackFrames[index])) { continue; }
+				if (vkGetFenceStatus(device, renderFences[i]) == VK_SUCCESS) {
+					index = i;
+				}
+			}
+			if (index < 0) { return false; }
+
+			size_t size = (size_t)win_width * win_height * TEX2D_CHANNELS;
+			_data.resize(size);
+			memcpy(_data.data(), readbackBuffers[index].allocation.mapped, size);
+			_width = win_width;
+			_height = win_height;
+			return true;
+		}
+
+		bool GraphicsVulkan::InitTimestampQueries() {
+			if (timestampValidBits == 0 || physicalDeviceProperties.limits.timestampPeriod == 0.f) {
+				LOG_WARN("[vulkan] timestamp queries not supported by graphics queue");
+				return false;
+			}
+
+			VkQueryPoolCreateInfo create_info = { VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
+			create_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+			create_info.queryCount = FRAMES_IN_FLIGHT * TIMESTAMPS_RENDER + FRAMES_IN_FLIGHT_2D * TIMESTAMPS_UPLOAD;
+			if (vkCreateQueryPool(device, &create_info, nullptr, &timestampPool) != VK_SUCCESS) {
+				LOG_ERROR("[vulkan] create timestamp query pool");
+				timestampPool = VK_NULL_HANDLE;
+				return false;
+			}
+
+			for (auto& n : timestampsWritten) {
+				n = false;
+			}
+			return true;
+		}
+
+		void GraphicsVulkan::DestroyTimestampQueries() {
+			if (timestampPool == VK_NULL_HANDLE) { return; }
+
+			WaitIdle();
+			vkDestroyQueryPool(device, timestampPool, nullptr);
+			timestampPool = VK_NULL_HANDLE;
+		}
+
+		// no VK_QUERY_RESULT_WAIT_BIT, the fence of the submit has to be signaled already
+		bool GraphicsVulkan::ReadTimestamps(const u32& _first, const u32& _count, u64* _ticks) {
+			if (timestampPool == VK_NULL_HANDLE) { return false; }
+
+			return vkGetQueryPoolResults(device, timestampPool, _first, _count, _count * sizeof(u64), _ticks, sizeof(u64), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS;
+		}
+
+		float GraphicsVulkan::TimestampDeltaMs(const u64& _begin, const u64& _end) const {
+			u64 mask = timestampValidBits >= 64 ? UINT64_MAX : ((u64)1 << timestampValidBits) - 1;
+			u64 ticks = (_end - _begin) & mask;
+			return (float)((double)ticks * physicalDeviceProperties.limits.timestampPeriod / 1000000.0);
+		}
+
+		gpu_timings GraphicsVulkan::GetGpuTimings() {
+			gpu_timings timings = {};
+			timings.supported = timestampPool != VK_NULL_HANDLE;
+
+			unique_lock<mutex> lock_timings(mutGpuTimings);
+			timings.upload = gpuTimeUpload.get();
+			timings.draw_2d = gpuTimeDraw2d.get();
+			timings.imgui = gpuTimeImgui.get();
+			return timings;
+		}
+
+		graphics_memory_stats GraphicsVulkan::GetMemoryStats() {
+			return allocator.GetStats();
+		}
+
 		void GraphicsVulkan::WaitIdle() {
 			if (vkDeviceWaitIdle(device) != VK_SUCCESS) {
 				LOG_ERROR("[vulkan] GPU wait idle");
@@ -1696,6 +3080,8 @@ namespace Backend {
 		void GraphicsVulkan::EnumerateShaders() {
 			LOG_INFO("[vulkan] enumerating shader source files");
 
+			StopShaderCompilation();
+
 			auto enumeratedShaderFiles = vector<string>();
 
 			FileIO::get_files_in_path(enumeratedShaderFiles, shaderFolder);
@@ -1725,45 +3111,92 @@ namespace Backend {
 				shadersCompiled = 0;
 				shadersTotal = (int)(shaderSourceFiles.size());
 				shaderCompilationFinished = false;
+				pipelines.resize(shadersTotal);
+
+				FileIO::check_and_create_path(shaderFolder + SHADER_CACHE);
 
-				compiler = shaderc_compiler_initialize();
-				options = shaderc_compile_options_initialize();
-				shaderc_compile_options_set_auto_map_locations(options, true);
+				// compile all pairs concurrently (one job each), the results get turned into shader modules by CompileNextShader() on the render thread
+				shaderResults.clear();
+				shaderWorkersRunning.store(true);
+
+				for (int i = 0; i < shadersTotal; i++) {
+					if (jobSystem != nullptr) {
+						shaderJobs.emplace_back(jobSystem->Submit([this, i]() -> void { CompileShader(i); }));
+					} else {
+						CompileShader(i);
+					}
+				}
+				LOG_INFO("[vulkan] compiling shaders on ", jobSystem != nullptr ? jobSystem->GetWorkerCount() : 1, " thread(s)");
 			}
 		}
 
-		void GraphicsVulkan::CompileNextShader() {
-			bool compiled = true;
-			vector<char> vertex_byte_code;
-			if (!compile_shader(vertex_byte_code, shaderSourceFiles[shadersCompiled].first, compiler, options, shaderFolder + SHADER_CACHE)) {
-				compiled = false;
-			}
-			vector<char> fragment_byte_code;
-			if (!compile_shader(fragment_byte_code, shaderSourceFiles[shadersCompiled].second, compiler, options, shaderFolder + SHADER_CACHE)) {
-				compiled = false;
+		void GraphicsVulkan::CompileShader(const int& _index) {
+			// stopped -> counted as failed, CompileNextShader() still has to reach shadersTotal
+			if (!shaderWorkersRunning.load()) {
+				shader_compile_result result = {};
+				result.index = _index;
+				unique_lock<mutex> lock_results(mutShaderResults);
+				shaderResults.emplace_back(std::move(result));
+				return;
 			}
+			TRACE_ZONE("CompileShader");
+
+			shaderc_compiler_t compiler = shaderc_compiler_initialize();
+			shaderc_compile_options_t options = shaderc_compile_options_initialize();
+			u64 cache_key = init_compile_options(options);
+			const string shader_cache = shaderFolder + SHADER_CACHE;
 
-			if (compiled) {
-				VkShaderModule vertex_shader;
-				VkShaderModule fragment_shader;
+			shader_compile_result result = {};
+			result.index = _index;
+			result.compiled = compile_shader(result.vertex_byte_code, shaderSourceFiles[_index].first, compiler, options, shader_cache, cache_key);
+			result.compiled &= compile_shader(result.fragment_byte_code, shaderSourceFiles[_index].second, compiler, options, shader_cache, cache_key);
 
-				if (InitShaderModule(vertex_byte_code, vertex_shader) && InitShaderModule(fragment_byte_code, fragment_shader)) {
-					pipelines.emplace_back();
-					auto& [layout, pipeline] = pipelines.back();
-					//InitPipeline(vertex_shader, fragment_shader, layout, pipeline, buffer_info);
-					// only used while no pipelines are created, remove destroy calls later
-					vkDestroyShaderModule(device, vertex_shader, nullptr);
-					vkDestroyShaderModule(device, fragment_shader, nullptr);
+			shaderc_compiler_release(compiler);
+			shaderc_compile_options_release(options);
+
+			unique_lock<mutex> lock_results(mutShaderResults);
+			shaderResults.emplace_back(std::move(result));
+		}
+
+		void GraphicsVulkan::CompileNextShader() {
+			if (shaderCompilationFinished) { return; }
+
+			auto results = vector<shader_compile_result>();
+			{
+				unique_lock<mutex> lock_results(mutShaderResults);
+				results.swap(shaderResults);
+			}
+
+			// results arrive in completion order, each one goes to the slot of its pair
+			for (const auto& n : results) {
+				if (n.compiled) {
+					VkShaderModule vertex_shader;
+					VkShaderModule fragment_shader;
+
+					if (InitShaderModule(n.vertex_byte_code, vertex_shader) && InitShaderModule(n.fragment_byte_code, fragment_shader)) {
+						auto& [layout, pipeline] = pipelines[n.index];
+						//InitPipeline(vertex_shader, fragment_shader, layout, pipeline, buffer_info);
+						// only used while no pipelines are created, remove destroy calls later
+						vkDestroyShaderModule(device, vertex_shader, nullptr);
+						vkDestroyShaderModule(device, fragment_shader, nullptr);
+					}
 				}
+				shadersCompiled++;
 			}
 
-			shadersCompiled++;
 			if (shadersCompiled == shadersTotal) {
+				StopShaderCompilation();
 				shaderCompilationFinished = true;
+				LOG_INFO("[vulkan] ", shadersTotal, " shader(s) processed");
+			}
+		}
 
-				shaderc_compiler_release(compiler);
-				shaderc_compile_options_release(options);
+		void GraphicsVulkan::StopShaderCompilation() {
+			shaderWorkersRunning.store(false);
+			for (const auto& n : shaderJobs) {
+				jobSystem->Wait(n);
 			}
+			shaderJobs.clear();
 		}
 
 		u32 GraphicsVulkan::FindMemoryTypes(u32 _type_filter, VkMemoryPropertyFlags _mem_properties) {
@@ -1825,25 +3258,64 @@ namespace Backend {
 		}
 		#endif
 
-		bool compile_shader(vector<char>& _byte_code, const string& _shader_source_file, const shaderc_compiler_t& _compiler, const shaderc_compile_options_t& _options, const std::string& _shader_cache) {
+		// every option applied here has to be part of the returned key, otherwise cached SPIR-V compiled with different options would be reused
+		u64 init_compile_options(shaderc_compile_options_t& _options) {
+			string options_desc = "auto_map_locations=1;";
+			shaderc_compile_options_set_auto_map_locations(_options, true);
+
+			unsigned int spv_version, spv_revision;
+			shaderc_get_spv_version(&spv_version, &spv_revision);
+			options_desc += std::format("spv={:d}.{:d};", spv_version, spv_revision);
+			options_desc += std::format("compiler={};", SHADER_STRINGIFY(SHADER_COMPILER_VERSION));
+
+			return Helpers::fnv1a_64(options_desc.data(), options_desc.size());
+		}
+
+		bool compile_shader(vector<char>& _byte_code, const string& _shader_source_file, const shaderc_compiler_t& _compiler, const shaderc_compile_options_t& _options, const std::string& _shader_cache, const u64& _cache_key) {
 			auto source_text_vec = vector<char>();
 			if (!FileIO::read_data(source_text_vec, _shader_source_file)) {
 				LOG_ERROR("[vulkan] read shader source ", _shader_source_file);
 				return false;
 			}
 
-			size_t source_size = source_text_vec.size();
-			shaderc_shader_kind type = SHADER_TYPES.at(Helpers::split_string(_shader_source_file, ".").back());
-			string file_name_str = Helpers::split_string(_shader_source_file, "/").back();
-			const char* file_name = file_name_str.c_str();
+			return compile_shader_source(_byte_code, source_text_vec, Helpers::split_string(_shader_source_file, "/").back(), _compiler, _options, _shader_cache, _cache_key);
+		}
 
-			shaderc_compilation_result_t result = shaderc_compile_into_spv(_compiler, source_text_vec.data(), source_size, type, file_name, "main", _options);
+		// whole words starting with the SPIR-V magic number
+		static bool is_spirv(const vector<char>& _byte_code) {
+			if (_byte_code.size() < sizeof(u32) || (_byte_code.size() % sizeof(u32)) != 0) { return false; }
+			u32 magic;
+			memcpy(&magic, _byte_code.data(), sizeof(u32));
+			return magic == SPIRV_MAGIC;
+		}
+
+		// _file_name: name used for diagnostics and the cache entry, its extension selects the shader stage
+		bool compile_shader_source(vector<char>& _byte_code, const vector<char>& _source, const string& _file_name, const shaderc_compiler_t& _compiler, const shaderc_compile_options_t& _options, const std::string& _shader_cache, const u64& _cache_key) {
+			size_t source_size = _source.size();
+			shaderc_shader_kind type = SHADER_TYPES.at(Helpers::split_string(_file_name, ".").back());
+
+			// cache entries are named <shader>_<stage>_<hash>.spv, the hash covers the source text, compile options and shaderc version
+			auto file_name_parts = Helpers::split_string(_file_name, ".");
+			string cache_prefix = file_name_parts.front() + "_" + file_name_parts.back() + "_";
+			u64 source_hash = Helpers::fnv1a_64(_source.data(), source_size, _cache_key);
+			string cache_file_name = cache_prefix + std::format("{:016x}", source_hash) + "." + SPIRV_EXT;
+			string cache_file_path = _shader_cache + cache_file_name;
+
+			if (FileIO::check_file_exists(cache_file_path)) {
+				if (FileIO::read_data(_byte_code, cache_file_path) && is_spirv(_byte_code)) {
+					LOG_INFO("[vulkan] ", _file_name, " loaded from cache");
+					return true;
+				}
+				LOG_WARN("[vulkan] shader cache entry ", cache_file_name, " invalid, recompiling");
+			}
+
+			shaderc_compilation_result_t result = shaderc_compile_into_spv(_compiler, _source.data(), source_size, type, _file_name.c_str(), "main", _options);
 
 			size_t error_num = shaderc_result_get_num_errors(result);
 			//size_t warning_num = shaderc_result_get_num_warnings(result);
 			if (error_num > 0) {
 				const char* error = shaderc_result_get_error_message(result);
-				LOG_ERROR("[vulkan] compilation of ", _shader_source_file, ": ", error);
+				LOG_ERROR("[vulkan] compilation of ", _file_name, ": ", error);
 				shaderc_result_release(result);
 				return false;
 			}
@@ -1852,16 +3324,52 @@ namespace Backend {
 			const char* byte_code = shaderc_result_get_bytes(result);
 
 			_byte_code = vector<char>(byte_code, byte_code + size);
-
-			// uncomment this section to write the compiled bytecode to a *.spv file in ./shader/spir_v/
-			auto byte_code_vec = vector<char>(byte_code, byte_code + size);
-			auto file_name_parts = Helpers::split_string(file_name_str, ".");
-			string out_file_path = _shader_cache + file_name_parts.front() + "_" + file_name_parts.back() + "." + SPIRV_EXT;
-			FileIO::write_data(byte_code_vec, out_file_path, true);
 			shaderc_result_release(result);
 
-			LOG_INFO("[vulkan] ", file_name_str, " compiled");
+			// drop outdated entries of this shader before writing the new one
+			auto cached_files = vector<string>();
+			FileIO::get_files_in_path(cached_files, _shader_cache);
+			for (const auto& n : cached_files) {
+				const auto cached_file = Helpers::split_string(n, "/").back();
+				if (cached_file.starts_with(cache_prefix) && cached_file.size() == cache_file_name.size() && cached_file.compare(cache_file_name) != 0) {
+					std::error_code error;
+					std::filesystem::remove(n, error);
+				}
+			}
+			// written under a temporary name first, an interrupted write never leaves a truncated entry behind
+			const string cache_file_tmp = cache_file_path + ".tmp";
+			if (FileIO::write_data(_byte_code, cache_file_tmp, true)) {
+				std::error_code error;
+				std::filesystem::rename(cache_file_tmp, cache_file_path, error);
+				if (error) {
+					LOG_WARN("[vulkan] write shader cache entry ", cache_file_name, ": ", error.message());
+					std::filesystem::remove(cache_file_tmp, error);
+				}
+			}
+
+			LOG_INFO("[vulkan] ", _file_name, " compiled");
 			return true;
 		}
+
+		// synchronization2 only stages/accesses map to the legacy ones containing them, the rest shares the bit values
+		VkPipelineStageFlags legacy_stage(const VkPipelineStageFlags2KHR& _stage, const VkPipelineStageFlags& _none) {
+			VkPipelineStageFlags2KHR stage = _stage;
+			if (stage & (VK_PIPELINE_STAGE_2_COPY_BIT_KHR | VK_PIPELINE_STAGE_2_BLIT_BIT_KHR | VK_PIPELINE_STAGE_2_RESOLVE_BIT_KHR | VK_PIPELINE_STAGE_2_CLEAR_BIT_KHR)) {
+				stage = (stage & ~(VK_PIPELINE_STAGE_2_COPY_BIT_KHR | VK_PIPELINE_STAGE_2_BLIT_BIT_KHR | VK_PIPELINE_STAGE_2_RESOLVE_BIT_KHR | VK_PIPELINE_STAGE_2_CLEAR_BIT_KHR)) | VK_PIPELINE_STAGE_2_TRANSFER_BIT_KHR;
+			}
+			VkPipelineStageFlags legacy = (VkPipelineStageFlags)(stage & 0xFFFFFFFF);
+			return legacy == 0 ? _none : legacy;
+		}
+
+		VkAccessFlags legacy_access(const VkAccessFlags2KHR& _access) {
+			VkAccessFlags2KHR access = _access;
+			if (access & (VK_ACCESS_2_SHADER_SAMPLED_READ_BIT_KHR | VK_ACCESS_2_SHADER_STORAGE_READ_BIT_KHR)) {
+				access |= VK_ACCESS_2_SHADER_READ_BIT_KHR;
+			}
+			if (access & VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT_KHR) {
+				access |= VK_ACCESS_2_SHADER_WRITE_BIT_KHR;
+			}
+			return (VkAccessFlags)(access & 0xFFFFFFFF);
+		}
 	}
 }
\ No newline at end of file
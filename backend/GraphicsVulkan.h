@@ -14,6 +14,9 @@
 #endif
 
 #include "GraphicsMgr.h"
+#include "VulkanAllocator.h"
+#include "perf_helpers.h"
+#include "JobSystem.h"
 
 #include <vulkan/vulkan.h>
 #include <SDL_vulkan.h>
@@ -23,6 +26,8 @@
 #include <thread>
 #include <mutex>
 #include <atomic>
+#include <deque>
+#include <chrono>
 
 #ifndef GLM_FORCE_DEPTH_ZERO_TO_ONE
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -32,6 +37,11 @@
 
 #define FRAMES_IN_FLIGHT		2
 #define FRAMES_IN_FLIGHT_2D		2
+#define UPLOAD_RING_SIZE		(8 * 1024 * 1024)
+
+// timestamp queries: 2d draw begin/end + imgui end per frame in flight, upload begin/end per tex2d update slot
+#define TIMESTAMPS_RENDER		3
+#define TIMESTAMPS_UPLOAD		2
 
 namespace Backend {
 	namespace Graphics {
@@ -42,18 +52,60 @@ namespace Backend {
 
 		struct vulkan_buffer {
 			VkBuffer buffer;					// memory view (offset and size)
-			VkDeviceMemory memory;				// allocated memory
+			vulkan_allocation allocation;		// range of a memory block from the allocator
 		};
 
 		struct vulkan_image {
 			VkImage image;
 			VkImageView image_view;
-			VkDeviceMemory memory;
+			vulkan_allocation allocation;
+		};
+
+		// uploads of one frame get recorded into the same command buffer and submitted together
+		struct upload_batch {
+			VkCommandPool command_pool = VK_NULL_HANDLE;
+			VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+			VkFence fence = VK_NULL_HANDLE;
+			VkDeviceSize end = 0;					// ring position after the last upload of this batch
+			bool recording = false;
+			bool in_flight = false;
+		};
+
+		struct upload_ring {
+			vulkan_buffer buffer = {};
+			VkDeviceSize size = 0;
+			VkDeviceSize alignment = 16;
+			VkDeviceSize head = 0;					// next write position
+			VkDeviceSize tail = 0;					// begin of the oldest range the GPU might still read, head == tail -> empty
+			std::vector<upload_batch> batches = std::vector<upload_batch>(FRAMES_IN_FLIGHT);
+			int batch_index = 0;					// batch currently recording (or the oldest one in flight)
+		};
+
+		struct shader_compile_result {
+			int index = 0;							// pair in shaderSourceFiles
+			bool compiled = false;
+			std::vector<char> vertex_byte_code;
+			std::vector<char> fragment_byte_code;
+		};
+
+		struct tex2d_layer {
+			graphics_layer_information info = {};
+			u64 offset = 0;							// position in the staging buffers
+			u64 size = 0;
+			glm::vec4 transform = {};				// xy: scale, zw: offset (NDC)
+			glm::vec4 uv_scale = {};				// layer size / image size
 		};
 
 		struct tex2d_data {
 			VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
 
+			// every layer owns one array layer of the image and a range of each staging buffer,
+			// more than one layer -> runtime compiled instanced pipeline instead of the precompiled one
+			std::vector<tex2d_layer> layers;
+			bool layered = false;
+			u32 width = 0;							// image size (largest layer)
+			u32 height = 0;
+
 			vulkan_buffer vertex_buffer = {};
 			vulkan_buffer index_buffer = {};
 			vulkan_image image = {};
@@ -65,6 +117,7 @@ namespace Backend {
 			std::vector<vulkan_buffer> staging_buffer = std::vector<vulkan_buffer>();
 
 			int update_index = 0;
+			bool force_update = false;				// upload even if the mailbox has no new frame (initial image layout transition)
 			alignas(64) std::atomic<bool> cmdbuf_0_submitted = true;
 			alignas(64) std::atomic<bool> cmdbuf_1_submitted = true;
 			std::vector<std::atomic<bool>*> cmdbufSubmitSignals = std::vector<std::atomic<bool>*>({ &cmdbuf_0_submitted, &cmdbuf_1_submitted });
@@ -86,6 +139,45 @@ namespace Backend {
 			glm::mat4 scale_matrix = {};
 		};
 
+		// compute upscale chain: tex2d image -> stage 0 -> ... -> stage n, the last image gets presented instead of the tex2d image
+		struct upscale_stage {
+			upscale_pass pass = {};
+			vulkan_image image = {};
+			u32 width = 0;
+			u32 height = 0;
+			VkDescriptorSet descriptor_set = VK_NULL_HANDLE;
+		};
+
+		struct upscale_push_constants {
+			i32 src_size[2];
+			i32 dst_size[2];
+			float strength;
+		};
+
+		struct upscale_data {
+			std::vector<upscale_pass> passes;						// requested chain
+			bool changed = false;									// applied before the next texture upload
+			std::vector<upscale_stage> stages;						// active chain
+
+			VkDescriptorPool descriptor_pool = VK_NULL_HANDLE;
+			VkDescriptorSetLayout descriptor_set_layout = VK_NULL_HANDLE;
+			VkPipelineLayout pipeline_layout = VK_NULL_HANDLE;
+			VkPipeline pipelines[UPSCALE_FILTER_NUM] = {};			// compiled on first use
+			VkSampler linear_sampler = VK_NULL_HANDLE;
+		};
+
+		// resources of a replaced swapchain, destroyed once the frames that were in flight at the rebuild completed
+		// and the presentation engine released its images (present fences, otherwise later frames on the new swapchain)
+		struct retired_swapchain {
+			VkSwapchainKHR swapchain = VK_NULL_HANDLE;
+			std::vector<VkImageView> image_views;
+			std::vector<VkFramebuffer> frame_buffers;
+			std::vector<VkCommandBuffer> static_command_buffers;
+			u64 frame_serials[FRAMES_IN_FLIGHT] = {};				// last submit per frame in flight at the time of the rebuild
+			u64 present_serials[FRAMES_IN_FLIGHT] = {};				// last present per frame in flight at the time of the rebuild
+			u64 retire_serial = 0;									// last submit on the old swapchain
+		};
+
 		class GraphicsVulkan : protected GraphicsMgr {
 		public:
 			friend class GraphicsMgr;
@@ -115,6 +207,15 @@ namespace Backend {
 
 			void SetSwapchainSettings(bool& _present_mode_fifo, bool& _triple_buffering) override;
 
+			graphics_memory_stats GetMemoryStats() override;
+			bool ReadbackFrame(std::vector<u8>& _data, u32& _width, u32& _height) override;
+			gpu_timings GetGpuTimings() override;
+
+			void SetLowLatencyMode(const bool& _enable, const bool& _single_frame_in_flight) override;
+			latency_stats GetLatencyStats() override;
+
+			void SetUpscaleChain(const std::vector<upscale_pass>& _passes) override;
+
 		private:
 			// constructor/destructor
 			explicit GraphicsVulkan(SDL_Window** _window, const graphics_settings& _settings);
@@ -131,6 +232,7 @@ namespace Backend {
 			alignas(64) std::atomic<bool> submitRunning = true;
 			uint32_t familyIndex = (uint32_t)-1;
 			VkPhysicalDeviceMemoryProperties devMemProps = {};
+			VulkanAllocator allocator;
 
 			// swapchain
 			uint32_t minImageCount = 2;
@@ -141,6 +243,18 @@ namespace Backend {
 			std::vector<VkImage> images;
 			VkPresentModeKHR presentMode = {};
 			std::vector<VkImageView> imageViews;
+			std::vector<retired_swapchain> retiredSwapchains;
+			void DestroyRetiredSwapchains(const bool& _all);
+			bool RetiredSwapchainInUse(const retired_swapchain& _retired);
+
+			// headless (render targets replace the swapchain images)
+			std::vector<vulkan_image> offscreenTargets;
+			std::vector<vulkan_buffer> readbackBuffers = std::vector<vulkan_buffer>(FRAMES_IN_FLIGHT);
+			std::vector<u64> readbackFrames = std::vector<u64>(FRAMES_IN_FLIGHT);		// frame number rendered into the slot, 0 -> none
+			u64 frameCounter = 0;
+			bool InitOffscreenTargets();
+			void DestroyOffscreenTargets();
+			void RecordReadback(VkCommandBuffer& _command_buffer, const u32& _index);
 
 			// context
 			VkSurfaceKHR surface = {};
@@ -154,29 +268,91 @@ namespace Backend {
 			VkRenderPass renderPass = {};
 			VkSampleCountFlagBits sample_count = VK_SAMPLE_COUNT_1_BIT;
 
+			// VK_KHR_dynamic_rendering: no render pass/framebuffers, the render target transitions get recorded explicitly
+			// VK_KHR_synchronization2: barriers with separate stage/access masks per image, otherwise mapped to the legacy barrier
+			bool dynamicRendering = false;
+			bool synchronization2 = false;
+			PFN_vkCmdBeginRenderingKHR pfnCmdBeginRendering = nullptr;
+			PFN_vkCmdEndRenderingKHR pfnCmdEndRendering = nullptr;
+			PFN_vkCmdPipelineBarrier2KHR pfnCmdPipelineBarrier2 = nullptr;
+			void ImageBarrier(VkCommandBuffer& _command_buffer, const VkImage& _image, const VkImageLayout& _old_layout, const VkImageLayout& _new_layout,
+				const VkPipelineStageFlags2KHR& _src_stage, const VkAccessFlags2KHR& _src_access, const VkPipelineStageFlags2KHR& _dst_stage, const VkAccessFlags2KHR& _dst_access, const u32& _layer = 0);
+
 			// main buffers
 			std::vector<VkFramebuffer> frameBuffers;
 			VkCommandBuffer commandBuffers[FRAMES_IN_FLIGHT] = {};
 			VkCommandPool commandPools[FRAMES_IN_FLIGHT] = {};
 
+			// render pass content as secondary command buffers: the static draw is recorded once per framebuffer and only
+			// re-recorded when invalidated (scale matrix, framebuffers, pipelines), imgui gets recorded every frame
+			VkCommandBuffer imguiCommandBuffers[FRAMES_IN_FLIGHT] = {};
+			VkCommandPool staticCommandPool = VK_NULL_HANDLE;
+			std::vector<VkCommandBuffer> staticCommandBuffers;
+			bool staticCommandsDirty = true;
+			bool RecordStaticCommands();
+			bool BeginSecondaryCommandBuffer(VkCommandBuffer& _command_buffer, const VkFramebuffer& _framebuffer, const VkCommandBufferUsageFlags& _flags);
+
 			VkBufferUsageFlags bufferUsageFlags = {};
 			VkMemoryPropertyFlags memoryPropertyFlags = {};
 
 			// graphics pipeline
 			std::vector<std::string> enumeratedShaderFiles;										// contains all shader source files
 			std::vector<std::pair<std::string, std::string>> shaderSourceFiles;					// contains the vertex and fragment shaders in groups of two
-			shaderc_compiler_t compiler = {};
-			shaderc_compile_options_t options = {};
-			std::vector<std::pair<VkPipelineLayout, VkPipeline>> pipelines;
+			std::vector<job_handle> shaderJobs;													// one per pair, each owns its shaderc compiler, they are not thread safe
+			alignas(64) std::atomic<bool> shaderWorkersRunning = false;
+			std::vector<shader_compile_result> shaderResults;									// filled by the jobs, consumed on the render thread
+			std::mutex mutShaderResults;
+			void CompileShader(const int& _index);
+			void StopShaderCompilation();
+			std::vector<std::pair<VkPipelineLayout, VkPipeline>> pipelines;						// per pair in shaderSourceFiles, null until compiled
 			VkViewport viewport = {};
 			VkRect2D scissor = {};
 
 			// main sync
 			std::vector<VkFence> renderFences = std::vector<VkFence>(FRAMES_IN_FLIGHT);
+			u64 submitSerial = 0;
+			u64 frameSerials[FRAMES_IN_FLIGHT] = {};													// serial of the last submit per frame in flight
+			// VK_EXT_swapchain_maintenance1: signaled once the presentation engine is done with the presented image
+			bool surfaceMaintenance = false;
+			bool swapchainMaintenance = false;
+			std::vector<VkFence> presentFences = std::vector<VkFence>(FRAMES_IN_FLIGHT);
+			u64 presentSerial = 0;
+			u64 presentSerials[FRAMES_IN_FLIGHT] = {};												// serial of the last present with a pending fence per frame in flight
 			std::vector<VkSemaphore> acquireSemaphores = std::vector<VkSemaphore>(FRAMES_IN_FLIGHT);
 			std::vector<VkSemaphore> releaseSemaphores = std::vector<VkSemaphore>(FRAMES_IN_FLIGHT);
 			VkPipelineStageFlags waitFlags = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;				// swapchain
 
+			// gpu timestamps, results get read once the fence of the corresponding submit signaled (no stalls)
+			VkQueryPool timestampPool = VK_NULL_HANDLE;
+			u32 timestampValidBits = 0;
+			bool timestampsWritten[FRAMES_IN_FLIGHT + FRAMES_IN_FLIGHT_2D] = {};
+			rolling_stats gpuTimeUpload;
+			rolling_stats gpuTimeDraw2d;
+			rolling_stats gpuTimeImgui;
+			std::mutex mutGpuTimings;
+			bool InitTimestampQueries();
+			void DestroyTimestampQueries();
+			bool ReadTimestamps(const u32& _first, const u32& _count, u64* _ticks);
+			float TimestampDeltaMs(const u64& _begin, const u64& _end) const;
+
+			// low latency: frames in flight at runtime (<= FRAMES_IN_FLIGHT), present timing via VK_KHR_present_id/present_wait
+			u32 framesInFlight = FRAMES_IN_FLIGHT;
+			u32 apiVersion = VK_API_VERSION_1_0;
+			bool presentWaitSupported = false;
+			PFN_vkWaitForPresentKHR pfnWaitForPresent = nullptr;
+			u64 presentId = 0;
+			std::deque<std::pair<u64, std::chrono::steady_clock::time_point>> pendingPresents;		// present id, input sample time
+			std::chrono::steady_clock::time_point lastFrameStart = std::chrono::steady_clock::now();
+			rolling_stats frameInterval;
+			rolling_stats frameBlocked;
+			rolling_stats frameWork;
+			rolling_stats frameRecording;
+			rolling_stats framePresent;
+			rolling_stats inputToPresent;
+			std::mutex mutLatency;
+			void PollPresentWait();
+			void UpdateFrameStartDelay(const std::chrono::nanoseconds& _blocked);
+
 			// imgui
 			VkDescriptorPool imguiDescriptorPool = {};
 
@@ -210,14 +386,25 @@ namespace Backend {
 			bool InitShaderModule(const std::vector<char>& _byte_code, VkShaderModule& _shader);
 			bool InitPipeline(VkShaderModule& _vertex_shader, VkShaderModule& _fragment_shader, VkPipelineLayout& _layout, VkPipeline& _pipeline, VulkanPipelineBufferInfo& _info, std::vector<VkDescriptorSetLayout>& _set_leyouts, std::vector<VkPushConstantRange>& _push_constants);
 			void SetGPUInfo();
-			bool InitBuffer(vulkan_buffer& _buffer, u64 _size, VkBufferUsageFlags _usage, VkMemoryPropertyFlags _memory_properties);
-			bool InitImage(vulkan_image& _image, u32 _width, u32 _height, VkFormat _format, VkImageUsageFlags _usage, VkImageTiling _tiling);
+			bool InitBuffer(vulkan_buffer& _buffer, u64 _size, VkBufferUsageFlags _usage, VkMemoryPropertyFlags _memory_properties, const ALLOCATION_POOL& _pool = POOL_FREE_LIST);
+			bool InitImage(vulkan_image& _image, u32 _width, u32 _height, VkFormat _format, VkImageUsageFlags _usage, VkImageTiling _tiling, const u32& _layers = 1);
 			bool InitSemaphore(VkSemaphore& _semaphore);
 
 			bool LoadBuffer(vulkan_buffer& _buffer, void* _data, size_t _size);
 
+			// staging ring for device local buffers (without resizable bar)
+			upload_ring uploadRing = {};
+			std::mutex mutUpload;
+			bool InitUploadRing(const VkDeviceSize& _size);
+			void DestroyUploadRing();
+			bool AllocateUpload(const VkDeviceSize& _size, VkDeviceSize& _offset);
+			bool BeginUploadBatch();
+			void SubmitUploadBatch();
+			bool RetireUploadBatches(const bool& _wait_oldest);
+			void FlushUploads();
+
 			// deinitialize
-			void DestroySwapchain(const bool& _rebuild);
+			void DestroySwapchain();
 			void DestroySurface();
 			void DestroyRenderPass();
 			void DestroyFrameBuffers();
@@ -243,6 +430,17 @@ namespace Backend {
 			bool InitTex2dSampler();
 			void DestroyTex2dSampler();
 			bool InitTex2dDescriptorSets();
+			void WriteTex2dDescriptorSet();
+			bool InitTex2dLayers();
+			bool CompileEmbeddedShader(const std::string& _file_name, const char* _source, std::vector<char>& _byte_code);
+
+			// compute upscaling
+			upscale_data upscaleData = {};
+			bool computeSupported = false;
+			bool InitUpscaleChain();
+			void DestroyUpscaleChain(const bool& _pipelines);
+			bool InitUpscalePipeline(const UPSCALE_FILTER& _filter);
+			void RecordUpscaleChain(VkCommandBuffer& _command_buffer);
 
 			u32 FindMemoryTypes(u32 _type_filter, VkMemoryPropertyFlags _mem_properties);
 			void DetectResizableBar() override;
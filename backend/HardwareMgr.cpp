@@ -21,20 +21,44 @@ namespace Backend {
 	control_settings HardwareMgr::controlSettings = {};
 	network_settings HardwareMgr::networkSettings = {};
 
-	std::chrono::milliseconds HardwareMgr::timePerFrame = std::chrono::milliseconds();
-	std::mutex HardwareMgr::mutTimeDelta = std::mutex();
-	std::condition_variable  HardwareMgr::notifyTimeDelta = std::condition_variable();
+	frame_pacer HardwareMgr::framePacer = frame_pacer();
 	steady_clock::time_point HardwareMgr::timePointCur = steady_clock::now();
-	steady_clock::time_point HardwareMgr::timePointPrev = steady_clock::now();
+
+	rolling_stats HardwareMgr::cpuTimeEvents = rolling_stats(256);
+	rolling_stats HardwareMgr::cpuTimeUpload = rolling_stats(256);
+	rolling_stats HardwareMgr::cpuTimeRender = rolling_stats(256);
+	rolling_stats HardwareMgr::audioFill = rolling_stats(256);
+
+	FrameCapture HardwareMgr::frameCapture;
+
+	JobSystem HardwareMgr::jobSystem;
 
 	u32 HardwareMgr::currentMouseMove = 0;
 
 	inline const u32 ONE_SECOND = 999;
+	inline const int PERF_HISTOGRAM_BINS = 32;
+
+	static float ms_since(const steady_clock::time_point& _start) {
+		return duration_cast<nanoseconds>(steady_clock::now() - _start).count() / 1e6f;
+	}
 
 	/* *************************************************************************************************
 		INIT / DEINIT HARDWARE BACKEND
 	************************************************************************************************* */
-	void HardwareMgr::InitHardware(graphics_settings& _graphics_settings, audio_settings& _audio_settings, control_settings& _control_settings) {
+	static void log_init_phase(const char* _name, const steady_clock::time_point& _start) {
+		LOG_INFO("[init] ", _name, ": ", (float)duration_cast<microseconds>(steady_clock::now() - _start).count() / 1000.f, "ms");
+	}
+
+	// runs an init phase as job, logs its duration when done
+	static job_handle start_init_phase(JobSystem& _jobs, const char* _name, std::function<void()> _phase) {
+		return _jobs.Submit([_name, _phase]() -> void {
+			steady_clock::time_point start = steady_clock::now();
+			_phase();
+			log_init_phase(_name, start);
+		});
+	}
+
+	void HardwareMgr::InitHardware(graphics_settings& _graphics_settings, audio_settings& _audio_settings, control_settings& _control_settings, const job_settings& _job_settings) {
 		error = HW_ERROR::NONE;
 
 		if (instance == nullptr) {
@@ -50,8 +74,18 @@ namespace Backend {
 
 		SetFramerateTarget(graphicsSettings.framerateTarget, graphicsSettings.fpsUnlimited);
 
+		steady_clock::time_point init_start = steady_clock::now();
+		steady_clock::time_point phase_start = init_start;
+
+		TRACE_THREAD_NAME("main");
+		jobSystem.Start(_job_settings);
+
 		// sdl init
 		window = nullptr;
+		if (graphicsSettings.headless) {
+			// no display needed, SDL_VIDEODRIVER from the environment still takes precedence
+			SDL_SetHint(SDL_HINT_VIDEODRIVER, "offscreen");
+		}
 		if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER | SDL_INIT_GAMECONTROLLER | SDL_INIT_AUDIO) != 0) {
 			LOG_ERROR("[SDL]", SDL_GetError());
 			error = HW_ERROR::SDL_WINDOW_INIT;
@@ -59,54 +93,93 @@ namespace Backend {
 		} else {
 			LOG_INFO("[SDL] initialized");
 		}
+		log_init_phase("SDL", phase_start);
+
+		// startup graph, everything not depending on the vulkan device runs next to its creation:
+		//   window -> vulkan instance/device -> swapchain -> imgui (+ fonts) -> control (+ controller DB)
+		//          \-> shader compilation (jobs, modules get created on the render thread)
+		//   fonts, controller DB, window icon, audio device: jobs, waited for where needed (the main thread only helps with
+		//   the awaited job, never with shader compilation)
+		// the jobs write into these locals -> all of them get waited for on return (also on errors)
+		bool audio_initialized = false;
+		SDL_Surface* icon_surface = nullptr;
+		struct init_jobs {
+			std::vector<job_handle> jobs;
+			~init_jobs() {
+				for (const auto& n : jobs) { jobSystem.Wait(n, false); }
+			}
+		} pending;
 
-		// graphics init
+		ImGui::CreateContext();
+		ImGui::StyleColorsDark();
+
+		phase_start = steady_clock::now();
 		graphicsMgr = Graphics::GraphicsMgr::getInstance(&window, graphicsSettings);
-		if (graphicsMgr != nullptr) {
-			const char* file_c = graphicsSettings.icon.c_str();
-			SDL_Surface* icon = SDL_LoadBMP(file_c);
+		if (graphicsMgr == nullptr) {
+			error = HW_ERROR::GRAPHICS_INSTANCE;
+			return;
+		}
+		log_init_phase("window", phase_start);
 
-			SDL_SetWindowIcon(window, icon);
+		graphicsMgr->SetJobSystem(&jobSystem);
 
-			if (!graphicsMgr->InitGraphics()) { 
-				error = HW_ERROR::GRAPHICS_INIT;
-				return;
-			}
-			if (!graphicsMgr->StartGraphics(graphicsSettings.presentModeFifo, graphicsSettings.tripleBuffering)) {
-				error = HW_ERROR::GRAPHICS_START;
-				return;
-			}
+		controlMgr = Control::ControlMgr::getInstance();
+		if (controlMgr == nullptr) {
+			error = HW_ERROR::CONTROL_INSTANCE;
+			return;
+		}
 
-			ImGui::CreateContext();
-			ImGui::StyleColorsDark();
-			if (!graphicsMgr->InitImgui()) { 
-				error = HW_ERROR::IMGUI_INIT;
-				return;
-			}
+		job_handle audio_init = start_init_phase(jobSystem, "audio", [&audio_initialized]() -> void {
+			audioMgr = Audio::AudioMgr::getInstance();
+			if (audioMgr == nullptr) { return; }
+			audioMgr->InitAudioBackend(audioSettings, false);
+			audio_initialized = true;
+		});
+		job_handle controller_db = start_init_phase(jobSystem, "controller DB", []() -> void { controlMgr->LoadControllerDatabase(controlSettings); });
+		job_handle icon = start_init_phase(jobSystem, "icon", [&icon_surface]() -> void { icon_surface = SDL_LoadBMP(graphicsSettings.icon.c_str()); });
+		job_handle fonts = start_init_phase(jobSystem, "fonts", []() -> void { graphicsMgr->LoadFonts(); });
+		pending.jobs = { audio_init, controller_db, icon, fonts };
 
-			graphicsMgr->EnumerateShaders();
-		} else {
-			error = HW_ERROR::GRAPHICS_INSTANCE;
+		graphicsMgr->EnumerateShaders();
+
+		// graphics init
+		phase_start = steady_clock::now();
+		if (!graphicsMgr->InitGraphics()) { 
+			error = HW_ERROR::GRAPHICS_INIT;
+			return;
+		}
+		log_init_phase("vulkan device", phase_start);
+
+		phase_start = steady_clock::now();
+		if (!graphicsMgr->StartGraphics(graphicsSettings.presentModeFifo, graphicsSettings.tripleBuffering)) {
+			error = HW_ERROR::GRAPHICS_START;
 			return;
 		}
+		log_init_phase("vulkan swapchain", phase_start);
 
+		jobSystem.Wait(icon, false);
+		if (icon_surface != nullptr) {
+			SDL_SetWindowIcon(window, icon_surface);
+			SDL_FreeSurface(icon_surface);
+		}
 		SDL_SetWindowMinimumSize(window, graphicsSettings.win_width_min, graphicsSettings.win_height_min);
 
-		// audio init
-		audioMgr = Audio::AudioMgr::getInstance();
-		if (audioMgr != nullptr) {
-			audioMgr->InitAudioBackend(audioSettings, false);
-		} else {
-			error = HW_ERROR::AUDIO_INSTANCE;
+		jobSystem.Wait(fonts, false);
+		phase_start = steady_clock::now();
+		if (!graphicsMgr->InitImgui()) { 
+			error = HW_ERROR::IMGUI_INIT;
 			return;
 		}
+		log_init_phase("imgui", phase_start);
 
-		// control inti
-		controlMgr = Control::ControlMgr::getInstance();
-		if (controlMgr != nullptr) {
-			controlMgr->InitControl(controlSettings);
-		} else {
-			error = HW_ERROR::CONTROL_INSTANCE;
+		// control init
+		jobSystem.Wait(controller_db, false);
+		controlMgr->InitControl(controlSettings);
+
+		// audio init
+		jobSystem.Wait(audio_init, false);
+		if (!audio_initialized) {
+			error = HW_ERROR::AUDIO_INSTANCE;
 			return;
 		}
 
@@ -116,9 +189,13 @@ namespace Backend {
 			error = HW_ERROR::NETWORK_INSTANCE;
 			return;
 		}
+
+		log_init_phase("hardware initialized", init_start);
 	}
 
 	void HardwareMgr::ShutdownHardware() {
+		StopCapture();
+
 		// graphics
 		graphicsMgr->DestroyImgui();
 		ImGui_ImplSDL2_Shutdown();
@@ -127,6 +204,9 @@ namespace Backend {
 		graphicsMgr->StopGraphics();
 		graphicsMgr->ExitGraphics();
 
+		jobSystem.Stop();
+		controlMgr->ExitControl();
+
 		SDL_DestroyWindow(window);
 		SDL_Quit();
 	}
@@ -135,25 +215,31 @@ namespace Backend {
 		return error;
 	}
 
+	JobSystem& HardwareMgr::GetJobSystem() {
+		return jobSystem;
+	}
+
+	void HardwareMgr::SetTracing(const bool& _enable) {
+		Trace::set_enabled(_enable);
+	}
+
+	bool HardwareMgr::DumpTrace(const std::string& _path) {
+		return Trace::dump(_path);
+	}
+
 	/* *************************************************************************************************
 		HARDWARE EVENTS PROCESSING
 	************************************************************************************************* */
 	void HardwareMgr::ProcessTimedEvents() {
-		steady_clock::time_point cur = steady_clock::now();
-		u32 time_diff = (u32)duration_cast<milliseconds>(cur - timePointCur).count();
+		TRACE_ZONE("ProcessTimedEvents");
 
-		timePointCur = cur;
-		std::chrono::milliseconds c_time_diff = duration_cast<milliseconds>(timePointCur - timePointPrev);
 		// framerate
-		if (timePerFrame > c_time_diff) {
-			// std::unique_lock with std::condition_variable().wait_for() actually useless here but for
-			// whatever reason it consumes slightly less ressources than std::this_thread::sleep_for()
-			std::unique_lock lock_fps(mutTimeDelta);
-			notifyTimeDelta.wait_for(lock_fps, duration_cast<milliseconds>(timePerFrame - c_time_diff));
-			//std::this_thread::sleep_for(duration_cast<microseconds>(timePerFrame - c_time_diff));
-		}
+		framePacer.wait();
+		audioFill.add(audioMgr->GetStats().fill);
 
-		timePointPrev = steady_clock::now();
+		steady_clock::time_point cur = steady_clock::now();
+		u32 time_diff = (u32)duration_cast<milliseconds>(cur - timePointCur).count();
+		timePointCur = cur;
 
 
 		// process mouse
@@ -204,11 +290,15 @@ namespace Backend {
 	}
 
 	void HardwareMgr::RenderFrame() {
+		steady_clock::time_point start = steady_clock::now();
 		graphicsMgr->RenderFrame();
+		cpuTimeRender.add(ms_since(start));
 	}
 
 	void HardwareMgr::UpdateTexture2d() {
+		steady_clock::time_point start = steady_clock::now();
 		graphicsMgr->UpdateTexture2d();
+		cpuTimeUpload.add(ms_since(start));
 	}
 
 	void HardwareMgr::ToggleFullscreen() {
@@ -223,34 +313,286 @@ namespace Backend {
 		graphicsMgr->SetSwapchainSettings(_present_mode_fifo, _triple_buffering);
 	}
 
-	void HardwareMgr::SetFramerateTarget(const int& _target, const bool& _unlimited) {
+	void HardwareMgr::SetFramerateTarget(const double& _target, const bool& _unlimited) {
 		graphicsSettings.fpsUnlimited = _unlimited;
-		graphicsSettings.framerateTarget = _target;
+		graphicsSettings.framerateTarget = (int)std::round(_target);
 
-		if (graphicsSettings.framerateTarget > 0) {
-			timePerFrame = std::chrono::milliseconds((u32)(((1.f * pow(10, 3)) / graphicsSettings.framerateTarget)));
-		} else {
-			timePerFrame = std::chrono::milliseconds(0);
-		}
+		framePacer.set_rate(_target > 0 ? _target : .0);
+	}
+
+	void HardwareMgr::SetLowLatencyMode(const bool& _enable, const bool& _single_frame_in_flight) {
+		graphicsSettings.lowLatency = _enable;
+		graphicsSettings.singleFrameInFlight = _single_frame_in_flight;
+		graphicsMgr->SetLowLatencyMode(_enable, _single_frame_in_flight);
+	}
+
+	latency_stats HardwareMgr::GetLatencyStats() {
+		return graphicsMgr->GetLatencyStats();
+	}
+
+	void HardwareMgr::SetUpscaleChain(const std::vector<upscale_pass>& _passes) {
+		graphicsMgr->SetUpscaleChain(_passes);
+	}
+
+	void HardwareMgr::GetFramePacing(perf_stats& _frame_times, perf_stats& _jitter) {
+		_frame_times = framePacer.get_frame_times();
+		_jitter = framePacer.get_jitter();
 	}
 
 	ImFont* HardwareMgr::GetFont(const int& _index) {
 		return graphicsMgr->GetFont(_index);
 	}
 
+	bool HardwareMgr::GetShaderCompilationProgress(int& _compiled, int& _total) {
+		return graphicsMgr->GetShaderCompilationProgress(_compiled, _total);
+	}
+
+	graphics_memory_stats HardwareMgr::GetGraphicsMemoryStats() {
+		return graphicsMgr->GetMemoryStats();
+	}
+
+	gpu_timings HardwareMgr::GetGpuTimings() {
+		return graphicsMgr->GetGpuTimings();
+	}
+
+	// imgui window, has to be called between NextFrame() and RenderFrame()
+	void HardwareMgr::ShowGpuProfiler(bool* _open) {
+		if (!ImGui::Begin("GPU profiler", _open, ImGuiWindowFlags_AlwaysAutoResize)) {
+			ImGui::End();
+			return;
+		}
+
+		gpu_timings timings = graphicsMgr->GetGpuTimings();
+		if (!timings.supported) {
+			ImGui::TextUnformatted("timestamp queries not supported");
+		} else if (ImGui::BeginTable("gpu_timings", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+			ImGui::TableSetupColumn("pass");
+			ImGui::TableSetupColumn("min (ms)");
+			ImGui::TableSetupColumn("avg (ms)");
+			ImGui::TableSetupColumn("p99 (ms)");
+			ImGui::TableHeadersRow();
+
+			const std::pair<const char*, const perf_stats*> passes[] = {
+				{ "upload", &timings.upload },
+				{ "2d draw", &timings.draw_2d },
+				{ "imgui", &timings.imgui }
+			};
+			for (const auto& [name, stats] : passes) {
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn(); ImGui::TextUnformatted(name);
+				ImGui::TableNextColumn(); ImGui::Text("%.3f", stats->min);
+				ImGui::TableNextColumn(); ImGui::Text("%.3f", stats->avg);
+				ImGui::TableNextColumn(); ImGui::Text("%.3f", stats->p99);
+			}
+			ImGui::EndTable();
+		}
+
+		ImGui::End();
+	}
+
+	perf_overlay_stats HardwareMgr::GetPerfStats() {
+		perf_overlay_stats stats = {};
+		double rate = framePacer.get_rate();
+		stats.target_frame_time = rate > 0 ? (float)(1000.0 / rate) : 0.f;
+		stats.frame_time = framePacer.get_frame_times();
+		stats.pacing_error = framePacer.get_jitter();
+		stats.events = cpuTimeEvents.get();
+		stats.upload = cpuTimeUpload.get();
+		stats.render = cpuTimeRender.get();
+		stats.latency = graphicsMgr->GetLatencyStats();
+		stats.gpu = graphicsMgr->GetGpuTimings();
+		stats.audio_fill = audioFill.get();
+		stats.audio = audioMgr->GetStats();
+		return stats;
+	}
+
+	// imgui window, everything on the stack (no allocations per frame)
+	void HardwareMgr::ShowPerfOverlay(bool* _open) {
+		if (!ImGui::Begin("Performance", _open, ImGuiWindowFlags_AlwaysAutoResize)) {
+			ImGui::End();
+			return;
+		}
+
+		perf_overlay_stats stats = GetPerfStats();
+		const rolling_stats& frame_times = framePacer.get_frame_time_window();
+
+		if (stats.target_frame_time > 0) {
+			ImGui::Text("frame time %.2f ms (target %.2f ms)", stats.frame_time.last, stats.target_frame_time);
+		} else {
+			ImGui::Text("frame time %.2f ms (unlimited)", stats.frame_time.last);
+		}
+
+		// range: twice the target, unlimited -> twice the slowest recent frame
+		float range_max = stats.target_frame_time > 0 ? stats.target_frame_time * 2.f : std::max(stats.frame_time.max * 2.f, 1.f);
+		ImGui::PlotLines("##frame_times", [](void* _data, int _index) -> float {
+			return ((const rolling_stats*)_data)->at((size_t)_index);
+		}, (void*)&frame_times, (int)frame_times.size(), 0, nullptr, 0.f, range_max, ImVec2(0, 60));
+
+		float bins[PERF_HISTOGRAM_BINS];
+		char range_text[32];
+		frame_times.histogram(bins, PERF_HISTOGRAM_BINS, 0.f, range_max);
+		snprintf(range_text, sizeof(range_text), "0 - %.1f ms", range_max);
+		ImGui::PlotHistogram("##frame_time_histogram", bins, PERF_HISTOGRAM_BINS, 0, range_text, 0.f, FLT_MAX, ImVec2(0, 60));
+
+		if (ImGui::BeginTable("perf_stats", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+			ImGui::TableSetupColumn("ms");
+			ImGui::TableSetupColumn("avg");
+			ImGui::TableSetupColumn("p50");
+			ImGui::TableSetupColumn("p95");
+			ImGui::TableSetupColumn("p99");
+			ImGui::TableSetupColumn("max");
+			ImGui::TableHeadersRow();
+
+			const std::pair<const char*, const perf_stats*> rows[] = {
+				{ "frame time", &stats.frame_time },
+				{ "pacing error", &stats.pacing_error },
+				{ "CPU events", &stats.events },
+				{ "CPU upload", &stats.upload },
+				{ "CPU render", &stats.render },
+				{ "  blocked", &stats.latency.blocked },
+				{ "  recording", &stats.latency.recording },
+				{ "  present", &stats.latency.present },
+				{ "GPU upload", &stats.gpu.upload },
+				{ "GPU 2d draw", &stats.gpu.draw_2d },
+				{ "GPU imgui", &stats.gpu.imgui }
+			};
+			for (const auto& [name, row] : rows) {
+				// no timestamp queries -> GPU rows stay empty
+				if (row->samples == 0) { continue; }
+
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn(); ImGui::TextUnformatted(name);
+				ImGui::TableNextColumn(); ImGui::Text("%.3f", row->avg);
+				ImGui::TableNextColumn(); ImGui::Text("%.3f", row->p50);
+				ImGui::TableNextColumn(); ImGui::Text("%.3f", row->p95);
+				ImGui::TableNextColumn(); ImGui::Text("%.3f", row->p99);
+				ImGui::TableNextColumn(); ImGui::Text("%.3f", row->max);
+			}
+			ImGui::EndTable();
+		}
+
+		ImGui::Text("audio ring %.0f%% (min %.0f%%), %llu underrun(s) in %llu callback(s)", stats.audio.fill * 100.f, stats.audio_fill.min * 100.f,
+			(unsigned long long)stats.audio.underruns, (unsigned long long)stats.audio.callbacks);
+
+		ImGui::End();
+	}
+
+	bool HardwareMgr::ReadbackFrame(std::vector<u8>& _data, u32& _width, u32& _height) {
+		return graphicsMgr->ReadbackFrame(_data, _width, _height);
+	}
+
+	/* *************************************************************************************************
+		CAPTURE
+	************************************************************************************************* */
+	bool HardwareMgr::StartCapture(const std::string& _path) {
+		int sampling_rate, channels;
+		audioMgr->GetOutputFormat(sampling_rate, channels);
+
+		if (!frameCapture.Start(_path, framePacer.get_rate(), sampling_rate, channels)) {
+			return false;
+		}
+		graphicsMgr->SetFrameCapture(&frameCapture);
+		audioMgr->SetFrameCapture(&frameCapture);
+		return true;
+	}
+
+	void HardwareMgr::StopCapture() {
+		if (!frameCapture.IsActive()) { return; }
+
+		// detach producers first, the encoder drains what's left
+		graphicsMgr->SetFrameCapture(nullptr);
+		audioMgr->SetFrameCapture(nullptr);
+		frameCapture.Stop();
+	}
+
+	capture_stats HardwareMgr::GetCaptureStats() {
+		return frameCapture.GetStats();
+	}
+
 	/* *************************************************************************************************
 		CONTROL BACKEND
 	************************************************************************************************* */
 	void HardwareMgr::ProcessEvents(bool& _running) {
+		TRACE_ZONE("ProcessEvents");
+
+		// low latency: sample input as late as possible, the delay adapts to the time the frame would otherwise block on the GPU/swapchain
+		if (std::chrono::nanoseconds delay = graphicsMgr->GetFrameStartDelay(); delay.count() > 0) {
+			std::this_thread::sleep_for(delay);
+		}
+
+		steady_clock::time_point start = steady_clock::now();
 		controlMgr->ProcessEvents(_running, window);
+		cpuTimeEvents.add(ms_since(start));
+		graphicsMgr->MarkInputSampled();
+	}
+
+	bool HardwareMgr::PopKeyEvent(key_event& _event) {
+		return controlMgr->PopKeyEvent(_event);
+	}
+
+	bool HardwareMgr::PopButtonEvent(button_event& _event) {
+		return controlMgr->PopButtonEvent(_event);
+	}
+
+	bool HardwareMgr::PopAxisEvent(axis_event& _event) {
+		return controlMgr->PopAxisEvent(_event);
+	}
+
+	u32 HardwareMgr::GetButtonState(const int& _player) {
+		return controlMgr->GetButtonState(_player);
+	}
+
+	axis_state HardwareMgr::GetAxisState(const int& _player) {
+		return controlMgr->GetAxisState(_player);
+	}
+
+	void HardwareMgr::SetAxisFilter(const float& _stick_deadzone, const float& _trigger_deadzone, const int& _event_threshold) {
+		controlSettings.stick_deadzone = _stick_deadzone;
+		controlSettings.trigger_deadzone = _trigger_deadzone;
+		controlSettings.axis_event_threshold = _event_threshold;
+		controlMgr->SetAxisFilter(_stick_deadzone, _trigger_deadzone, _event_threshold);
 	}
 
-	std::queue<std::pair<SDL_Keycode, bool>>& HardwareMgr::GetKeyQueue() {
-		return controlMgr->GetKeyQueue();
+	void HardwareMgr::SetPlayerCount(const int& _count) {
+		controlSettings.players = _count;
+		controlMgr->SetPlayerCount(_count);
 	}
 
-	std::queue<std::tuple<int, SDL_GameControllerButton, bool>>& HardwareMgr::GetButtonQueue() {
-		return controlMgr->GetButtonQueue();
+	int HardwareMgr::GetPlayerCount() {
+		return controlMgr->GetPlayerCount();
+	}
+
+	bool HardwareMgr::SetRumble(const int& _player, const float& _low_frequency, const float& _high_frequency, const u32& _duration_ms) {
+		return controlMgr->SetRumble(_player, _low_frequency, _high_frequency, _duration_ms);
+	}
+
+	bool HardwareMgr::StartInputRecording(const std::string& _path) {
+		return controlMgr->StartInputRecording(_path);
+	}
+
+	void HardwareMgr::StopInputRecording() {
+		controlMgr->StopInputRecording();
+	}
+
+	bool HardwareMgr::StartInputReplay(const std::string& _path) {
+		return controlMgr->StartInputReplay(_path);
+	}
+
+	void HardwareMgr::StopInputReplay() {
+		controlMgr->StopInputReplay();
+	}
+
+	bool HardwareMgr::IsInputReplayActive() {
+		return controlMgr->IsInputReplayActive();
+	}
+
+	void HardwareMgr::SetInputPollRate(const int& _rate) {
+		controlSettings.input_poll_rate = _rate;
+		if (_rate > 0) {
+			controlMgr->StartInputThread(_rate);
+		} else {
+			controlMgr->StopInputThread();
+		}
 	}
 
 	Sint32 HardwareMgr::GetScroll() {
@@ -282,6 +624,12 @@ namespace Backend {
 	}
 
 	void HardwareMgr::SetSamplingRate(int& _sampling_rate) {
+		// wav stream has a fixed format
+		if (frameCapture.IsActive()) {
+			LOG_WARN("[capture] sampling rate changed, capture stopped");
+			StopCapture();
+		}
+
 		audioSettings.sampling_rate = _sampling_rate;
 		audioMgr->SetSamplingRate(audioSettings);
 		_sampling_rate = audioSettings.sampling_rate;
@@ -5,6 +5,7 @@
 
 #include <chrono>
 #include <mutex>
+#include <thread>
 
 #include "defs.h"
 #include "logger.h"
@@ -24,6 +25,11 @@
 #include "FileMapper.h"
 #endif
 
+#include "perf_helpers.h"
+#include "FrameCapture.h"
+#include "JobSystem.h"
+#include "trace.h"
+
 namespace Backend {
 	enum HW_ERROR {
 		NONE =					0x0000,
@@ -42,10 +48,17 @@ namespace Backend {
 	class HardwareMgr {
 	public:
 		// Hardware manager general member methods
-		static void InitHardware(graphics_settings& _graphics_settings, audio_settings& _audio_settings, control_settings& _control_settings);
+		static void InitHardware(graphics_settings& _graphics_settings, audio_settings& _audio_settings, control_settings& _control_settings, const job_settings& _job_settings = {});
 		static void ShutdownHardware();
 		static HW_ERROR GetError();
 
+		// shared job system (shader compilation, file I/O, encoding, DSP), running between init and shutdown
+		static JobSystem& GetJobSystem();
+
+		// trace zones only get recorded while enabled, dump as Chrome trace JSON (chrome://tracing, ui.perfetto.dev)
+		static void SetTracing(const bool& _enable);
+		static bool DumpTrace(const std::string& _path);
+
 		static void ProcessEvents(bool& _running);
 		static void ProcessTimedEvents();
 		static Sint32 GetScroll();
@@ -62,11 +75,29 @@ namespace Backend {
 		static void RenderFrame();
 
 		static void UpdateTexture2d();
-		static void SetFramerateTarget(const int& _target, const bool& _unlimited);
+		static void SetFramerateTarget(const double& _target, const bool& _unlimited);		// non-integer rates of emulated systems (e.g. 59.7275Hz)
+		static void GetFramePacing(perf_stats& _frame_times, perf_stats& _jitter);
+		static void SetLowLatencyMode(const bool& _enable, const bool& _single_frame_in_flight);
+		static latency_stats GetLatencyStats();
+		static void SetUpscaleChain(const std::vector<upscale_pass>& _passes);
 		static void SetSwapchainSettings(bool& _present_mode_fifo, bool& _triple_buffering);
 		static void ToggleFullscreen();
 
 		static ImFont* GetFont(const int& _index);
+		static bool GetShaderCompilationProgress(int& _compiled, int& _total);
+		static graphics_memory_stats GetGraphicsMemoryStats();
+		static gpu_timings GetGpuTimings();
+		static void ShowGpuProfiler(bool* _open = nullptr);
+
+		// frame pacing, CPU time per subsystem, GPU time and audio ring state, ShowPerfOverlay() has to be called between NextFrame() and RenderFrame()
+		static perf_overlay_stats GetPerfStats();
+		static void ShowPerfOverlay(bool* _open = nullptr);
+		static bool ReadbackFrame(std::vector<u8>& _data, u32& _width, u32& _height);
+
+		// lossless capture of the 2d output + audio (<path>.cap / <path>.wav)
+		static bool StartCapture(const std::string& _path);
+		static void StopCapture();
+		static capture_stats GetCaptureStats();
 
 		// Audio backend
 		static void StartAudioBackend(virtual_audio_information& _virt_audio_info);
@@ -85,9 +116,25 @@ namespace Backend {
 		static bool CheckNetwork();
 		static void CloseNetwork();
 		
-		// Control backend / key presses
-		static std::queue<std::pair<SDL_Keycode, bool>>& GetKeyQueue();
-		static std::queue<std::tuple<int, SDL_GameControllerButton, bool>>& GetButtonQueue();
+		// Control backend / key presses: lock-free queues filled by ProcessEvents(), one consumer thread (e.g. emulation) may drain them
+		static bool PopKeyEvent(key_event& _event);
+		static bool PopButtonEvent(button_event& _event);
+		static bool PopAxisEvent(axis_event& _event);						// coalesced, see control_settings::axis_event_threshold
+		static u32 GetButtonState(const int& _player);					// latest pressed buttons (bit per SDL_GameControllerButton), any thread
+		static axis_state GetAxisState(const int& _player);				// latest axis values after the deadzones, any thread
+		static void SetAxisFilter(const float& _stick_deadzone, const float& _trigger_deadzone, const int& _event_threshold);
+		static bool SetRumble(const int& _player, const float& _low_frequency, const float& _high_frequency, const u32& _duration_ms);
+		static void SetPlayerCount(const int& _count);						// controller slots, up to Control::INPUT_PLAYERS_MAX
+		static int GetPlayerCount();
+		static void SetInputPollRate(const int& _rate);					// Hz, controllers polled on their own thread, 0 -> with the SDL events once per frame
+
+		// key/button events per frame into a compact binary file, replay feeds them back instead of the devices
+		// (with an unlimited frame rate and headless rendering -> reproducible throughput benchmark)
+		static bool StartInputRecording(const std::string& _path);
+		static void StopInputRecording();
+		static bool StartInputReplay(const std::string& _path);
+		static void StopInputReplay();
+		static bool IsInputReplayActive();
 
 	private:
 		HardwareMgr() = default;
@@ -119,11 +166,20 @@ namespace Backend {
 		static HW_ERROR error;
 
 		// framerate and timed events
-		static std::mutex mutTimeDelta;
-		static std::condition_variable  notifyTimeDelta;
-		static std::chrono::milliseconds timePerFrame;
+		static frame_pacer framePacer;
 		static std::chrono::steady_clock::time_point timePointCur;
-		static std::chrono::steady_clock::time_point timePointPrev;
+
+		// CPU time per subsystem (main loop thread)
+		static rolling_stats cpuTimeEvents;
+		static rolling_stats cpuTimeUpload;
+		static rolling_stats cpuTimeRender;
+		static rolling_stats audioFill;
+
+		// capture
+		static FrameCapture frameCapture;
+
+		// jobs
+		static JobSystem jobSystem;
 
 		// control
 		static u32 currentMouseMove;
@@ -2,21 +2,145 @@
 
 #include "defs.h"
 #include <vector>
+#include <array>
 #include <atomic>
 #include <functional>
 #include <complex>
 
 namespace Backend {
+	/* *************************************************************************************************
+		LOCK-FREE TRIPLE BUFFER FOR HANDING FINISHED FRAMES FROM THE EMULATION THREAD TO THE RENDER THREAD:
+		PRODUCER WRITES INTO ITS BACK BUFFER AND PUBLISHES IT, CONSUMER ALWAYS PICKS UP THE NEWEST
+		PUBLISHED FRAME (OLDER UNCONSUMED FRAMES GET DROPPED), NEITHER SIDE EVER WAITS
+	************************************************************************************************* */
+	class frame_mailbox {
+	public:
+		frame_mailbox() = default;
+		~frame_mailbox() = default;
+
+		// not thread safe, call before producer/consumer start
+		void init(const size_t& _size) {
+			for (auto& n : buffers) {
+				n = std::vector<u8>(_size, 0);
+			}
+			back = 0;
+			middle.store(1);
+			front = 2;
+		}
+
+		// producer
+		std::vector<u8>& write_buffer() { return buffers[back]; }
+		void publish() {
+			u8 prev = middle.exchange(back | NEW_FRAME, std::memory_order_acq_rel);
+			back = prev & INDEX_MASK;
+		}
+
+		// consumer, returns false if no frame got published since the last call
+		bool consume() {
+			if (!(middle.load(std::memory_order_relaxed) & NEW_FRAME)) { return false; }
+			u8 prev = middle.exchange(front, std::memory_order_acq_rel);
+			front = prev & INDEX_MASK;
+			return true;
+		}
+		const std::vector<u8>& read_buffer() const { return buffers[front]; }
+
+	private:
+		static constexpr u8 INDEX_MASK = 0x03;
+		static constexpr u8 NEW_FRAME = 0x04;
+
+		std::vector<u8> buffers[3];
+		alignas(64) u8 back = 0;						// producer only
+		alignas(64) std::atomic<u8> middle = 1;			// index of the exchanged buffer + new frame flag
+		alignas(64) u8 front = 2;						// consumer only
+	};
+
+	/* *************************************************************************************************
+		LOCK-FREE SINGLE PRODUCER / SINGLE CONSUMER RING WITH FIXED CAPACITY (POWER OF TWO):
+		WHILE FULL THE PRODUCER DROPS NEW ELEMENTS, NEITHER SIDE EVER WAITS OR ALLOCATES
+	************************************************************************************************* */
+	template <typename T, size_t N>
+	class spsc_ring {
+		static_assert(N > 0 && (N & (N - 1)) == 0, "spsc_ring capacity has to be a power of two");
+
+	public:
+		spsc_ring() = default;
+		~spsc_ring() = default;
+
+		// producer, false if full
+		bool push(const T& _value) {
+			size_t write = writeIndex.load(std::memory_order_relaxed);
+			if (write - cachedRead == N) {
+				cachedRead = readIndex.load(std::memory_order_acquire);
+				if (write - cachedRead == N) { return false; }
+			}
+			buffer[write & (N - 1)] = _value;
+			writeIndex.store(write + 1, std::memory_order_release);
+			return true;
+		}
+
+		// consumer, false if empty
+		bool pop(T& _value) {
+			size_t read = readIndex.load(std::memory_order_relaxed);
+			if (read == cachedWrite) {
+				cachedWrite = writeIndex.load(std::memory_order_acquire);
+				if (read == cachedWrite) { return false; }
+			}
+			_value = buffer[read & (N - 1)];
+			readIndex.store(read + 1, std::memory_order_release);
+			return true;
+		}
+
+		// consumer, drops everything published so far
+		void clear() {
+			cachedWrite = writeIndex.load(std::memory_order_acquire);
+			readIndex.store(cachedWrite, std::memory_order_release);
+		}
+
+		// snapshot, exact only on the consumer side
+		size_t size() const {
+			size_t read = readIndex.load(std::memory_order_acquire);
+			return writeIndex.load(std::memory_order_acquire) - read;
+		}
+		static constexpr size_t capacity() { return N; }
+
+	private:
+		std::array<T, N> buffer = {};
+		alignas(64) std::atomic<size_t> writeIndex = 0;
+		size_t cachedRead = 0;							// producer only, last seen read index
+		alignas(64) std::atomic<size_t> readIndex = 0;
+		size_t cachedWrite = 0;							// consumer only, last seen write index
+	};
+
+	// additional 2d output (second screen, debug view, another instance), placed in a normalized rect of the window
+	// (0,0 top left -> 1,1 bottom right), the aspect ratio gets kept inside the rect
+	struct graphics_layer_information {
+		std::vector<u8>* image_data = nullptr;
+		frame_mailbox* mailbox = nullptr;
+		u32 lcd_width = 0;
+		u32 lcd_height = 0;
+		float aspect_ratio = 1.f;
+		float x = 0.f;
+		float y = 0.f;
+		float width = 1.f;
+		float height = 1.f;
+	};
+
 	struct virtual_graphics_information {
 		// drawing mode
 		bool is2d = false;
 		bool en2d = false;
 
-		// data for gameboy output
+		// data for gameboy output, either image_data (read by the render thread directly) or mailbox (initialized
+		// with the image size before the graphics backend gets initialized, emulation publishes from its own thread)
 		std::vector<u8>* image_data = nullptr;
+		frame_mailbox* mailbox = nullptr;
 		u32 lcd_width = 0;
 		u32 lcd_height = 0;
 		float aspect_ratio = 1.f;
+
+		// empty -> single fullscreen layer from the fields above, otherwise these layers replace them
+		// (up to TEX2D_LAYERS_MAX, all uploaded with one submit and drawn with one instanced draw)
+		std::vector<graphics_layer_information> layers;
 	};
 
 	struct virtual_audio_information {
@@ -52,6 +176,99 @@ namespace Backend {
 		u32 v_patch = 0;
 		std::string font = "";
 		std::string shader_folder = "";
+		bool headless = false;						// render offscreen (no surface/swapchain), frames can be read back
+		bool lowLatency = false;					// start frames as late as possible before the present deadline
+		bool singleFrameInFlight = false;			// low latency only: CPU doesn't run ahead of the GPU
+	};
+
+	struct graphics_memory_stats {
+		u64 bytes_reserved = 0;						// device memory allocated from the driver
+		u64 bytes_used = 0;							// handed out to buffers/images
+		u64 bytes_wasted = 0;						// alignment padding
+		u32 device_allocations = 0;					// live vkAllocateMemory allocations
+		u32 allocations = 0;						// live sub-allocations
+	};
+
+	struct perf_stats {
+		float min = 0.f;
+		float max = 0.f;
+		float avg = 0.f;
+		float p50 = 0.f;
+		float p95 = 0.f;
+		float p99 = 0.f;
+		float last = 0.f;
+		u32 samples = 0;
+	};
+
+	// all times in ms
+	struct latency_stats {
+		bool low_latency = false;
+		bool present_wait = false;					// input_to_present measured until the image was presented (VK_KHR_present_wait), otherwise until queued for present
+		u32 frames_in_flight = 0;
+		float start_delay = 0.f;					// current delay of the frame start (input sampling)
+		perf_stats input_to_present = {};
+		perf_stats frame_work = {};					// input sampled -> frame submitted
+		perf_stats blocked = {};					// waiting for render fence/swapchain image
+		perf_stats recording = {};					// image acquired -> command buffer submitted
+		perf_stats present = {};					// vkQueuePresentKHR (can block on the present engine)
+	};
+
+	// GPU time per pass in ms
+	struct gpu_timings {
+		bool supported = false;
+		perf_stats upload = {};						// texture upload (tex2d staging buffer -> image)
+		perf_stats draw_2d = {};
+		perf_stats imgui = {};
+	};
+
+	struct audio_stats {
+		float fill = 0.f;							// share of the sample ring queued for SDL at the last callback (0 - 1)
+		u64 callbacks = 0;
+		u64 underruns = 0;							// callbacks that needed more samples than were queued (audio thread fell behind)
+	};
+
+	// everything the performance overlay shows, times in ms (CPU times measured on the calling thread)
+	struct perf_overlay_stats {
+		float target_frame_time = 0.f;				// 0 -> unlimited
+		perf_stats frame_time = {};
+		perf_stats pacing_error = {};				// frame started after the pacing deadline
+		perf_stats events = {};						// CPU: SDL event processing
+		perf_stats upload = {};						// CPU: 2d texture upload
+		perf_stats render = {};						// CPU: whole RenderFrame()
+		latency_stats latency = {};					// render internals: blocked, recording, present
+		gpu_timings gpu = {};
+		perf_stats audio_fill = {};					// audio ring fill sampled once per frame
+		audio_stats audio = {};
+	};
+
+	// compute post processing of the 2d output, passes run in order on the low resolution image
+	enum UPSCALE_FILTER {
+		UPSCALE_INTEGER,							// nearest neighbour
+		UPSCALE_SHARP_BILINEAR,						// nearest with anti aliased texel edges
+		UPSCALE_XBR,								// edge directed (xBR level 1)
+		UPSCALE_CRT,								// scanlines + aperture grille
+		UPSCALE_FILTER_NUM
+	};
+
+	struct upscale_pass {
+		UPSCALE_FILTER filter = UPSCALE_INTEGER;
+		u32 scale = 2;								// output size = input size * scale
+		float strength = 1.f;						// CRT: scanline/mask intensity
+	};
+
+	struct capture_stats {
+		bool active = false;
+		u64 frames_captured = 0;					// copied into the capture ring
+		u64 frames_dropped = 0;						// ring full, encoder fell behind
+		u64 frames_encoded = 0;
+		u64 audio_samples_dropped = 0;
+		u64 bytes_written = 0;
+	};
+
+	struct job_settings {
+		int workers = 0;							// 0 -> hardware threads - 1 (at most JOB_WORKERS_DEFAULT_MAX)
+		bool pin_cores = false;						// worker n runs on core first_core + n
+		int first_core = 0;
 	};
 
 	struct audio_settings {
@@ -72,6 +289,11 @@ namespace Backend {
 		bool mouse_always_visible = false;
 		std::string controller_db = "";
 		std::string bmp_custom_cursor = "";
+		int players = 1;							// controller slots (up to INPUT_PLAYERS_MAX), hot plugged controllers fill free slots
+		int input_poll_rate = 0;					// Hz, controllers get polled on their own thread (e.g. 1000), 0 -> sampled with the SDL events once per frame
+		float stick_deadzone = .15f;				// radial, share of the full stick range
+		float trigger_deadzone = .05f;
+		int axis_event_threshold = 512;				// change of an axis (raw units, 32767 = full range) needed for a new axis event
 	};
 
 	struct network_settings {
@@ -0,0 +1,214 @@
+#include "pch.h"
+#include "framework.h"
+
+#include "InputRecorder.h"
+
+#include "logger.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+namespace Backend {
+	inline const char INPUT_RECORD_MAGIC[8] = "BKINP01";
+	inline const u8 INPUT_RECORD_FLAG_BUTTON = 0x01;
+	inline const u8 INPUT_RECORD_FLAG_PRESSED = 0x02;
+	inline const u8 INPUT_RECORD_FLAG_AXIS = 0x04;
+
+	static void write_varint(std::vector<u8>& _dst, u64 _value) {
+		while (_value >= 0x80) {
+			_dst.push_back((u8)(_value | 0x80));
+			_value >>= 7;
+		}
+		_dst.push_back((u8)_value);
+	}
+
+	// false on truncated/oversized values
+	static bool read_varint(const std::vector<u8>& _src, size_t& _cursor, u64& _value) {
+		_value = 0;
+		for (int shift = 0; shift < 64; shift += 7) {
+			if (_cursor >= _src.size()) { return false; }
+			u8 byte = _src[_cursor++];
+			_value |= (u64)(byte & 0x7F) << shift;
+			if (!(byte & 0x80)) { return true; }
+		}
+		return false;
+	}
+
+	InputRecorder::~InputRecorder() {
+		StopRecording();
+	}
+
+	/* *************************************************************************************************
+		RECORDING
+	************************************************************************************************* */
+	bool InputRecorder::StartRecording(const std::string& _path, const u64& _frame) {
+		if (recording.load()) {
+			LOG_WARN("[input] already recording");
+			return false;
+		}
+
+		std::unique_lock<std::mutex> lock_record(mutRecord);
+		recordFile = std::ofstream(_path, std::ios::binary | std::ios::trunc);
+		if (!recordFile.is_open()) {
+			LOG_ERROR("[input] open ", _path);
+			return false;
+		}
+
+		recordBuffer.clear();
+		recordBuffer.reserve(INPUT_RECORD_FLUSH_SIZE + 32);
+		recordBuffer.insert(recordBuffer.end(), std::begin(INPUT_RECORD_MAGIC), std::end(INPUT_RECORD_MAGIC));
+		recordStart = _frame;
+		recordFrame = _frame;
+		recordCount = 0;
+		recording.store(true);
+
+		LOG_INFO("[input] recording to ", _path);
+		return true;
+	}
+
+	void InputRecorder::StopRecording() {
+		if (!recording.exchange(false)) { return; }
+
+		std::unique_lock<std::mutex> lock_record(mutRecord);
+		FlushRecords();
+		recordFile.close();
+
+		LOG_INFO("[input] recording stopped: ", recordCount, " event(s) in ", recordFrame - recordStart, " frame(s)");
+	}
+
+	bool InputRecorder::IsRecording() const {
+		return recording.load(std::memory_order_relaxed);
+	}
+
+	// the frame can lag behind when read on another thread than the one advancing it -> never goes backwards
+	void InputRecorder::Record(const input_record& _record) {
+		if (!recording.load(std::memory_order_relaxed)) { return; }
+
+		std::unique_lock<std::mutex> lock_record(mutRecord);
+		if (!recording.load()) { return; }
+
+		u64 frame = std::max(_record.frame, recordFrame);
+		write_varint(recordBuffer, frame - recordFrame);
+		recordFrame = frame;
+
+		u8 flags = (_record.pressed ? INPUT_RECORD_FLAG_PRESSED : 0);
+		switch (_record.device) {
+		case INPUT_RECORD_BUTTON:
+			flags |= INPUT_RECORD_FLAG_BUTTON;
+			break;
+		case INPUT_RECORD_AXIS:
+			flags |= INPUT_RECORD_FLAG_AXIS;
+			break;
+		default:
+			break;
+		}
+		recordBuffer.push_back(flags);
+		write_varint(recordBuffer, _record.code);
+		if (_record.device != INPUT_RECORD_KEY) {
+			write_varint(recordBuffer, _record.player);
+		}
+		if (_record.device == INPUT_RECORD_AXIS) {
+			// zigzag: small negative values stay small
+			write_varint(recordBuffer, ((u32)_record.value << 1) ^ (u32)(_record.value >> 31));
+		}
+		recordCount++;
+
+		if (recordBuffer.size() >= INPUT_RECORD_FLUSH_SIZE) {
+			FlushRecords();
+		}
+	}
+
+	// expects mutRecord to be locked
+	void InputRecorder::FlushRecords() {
+		if (recordBuffer.empty()) { return; }
+
+		recordFile.write((const char*)recordBuffer.data(), recordBuffer.size());
+		if (!recordFile.good()) {
+			LOG_ERROR("[input] write recording");
+		}
+		recordBuffer.clear();
+	}
+
+	/* *************************************************************************************************
+		REPLAY
+	************************************************************************************************* */
+	bool InputRecorder::StartReplay(const std::string& _path, const u64& _frame) {
+		std::ifstream file = std::ifstream(_path, std::ios::binary);
+		if (!file.is_open()) {
+			LOG_ERROR("[input] open ", _path);
+			return false;
+		}
+
+		replayData.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		if (replayData.size() < sizeof(INPUT_RECORD_MAGIC) || memcmp(replayData.data(), INPUT_RECORD_MAGIC, sizeof(INPUT_RECORD_MAGIC)) != 0) {
+			LOG_ERROR("[input] ", _path, " is no input recording");
+			replayData.clear();
+			return false;
+		}
+
+		replayCursor = sizeof(INPUT_RECORD_MAGIC);
+		replayFrame = _frame;
+		replayHasPending = false;
+		replaying.store(true);
+
+		LOG_INFO("[input] replaying ", _path);
+		return true;
+	}
+
+	void InputRecorder::StopReplay() {
+		if (!replaying.exchange(false)) { return; }
+
+		replayData.clear();
+		LOG_INFO("[input] replay stopped");
+	}
+
+	bool InputRecorder::IsReplaying() const {
+		return replaying.load(std::memory_order_relaxed);
+	}
+
+	bool InputRecorder::IsReplayFinished() const {
+		return !replayHasPending && replayCursor >= replayData.size();
+	}
+
+	bool InputRecorder::NextReplayRecord(const u64& _frame, input_record& _record) {
+		if (!replaying.load(std::memory_order_relaxed)) { return false; }
+
+		if (!replayHasPending) {
+			if (replayCursor >= replayData.size()) { return false; }
+			if (!DecodeReplayRecord(replayPending)) {
+				LOG_WARN("[input] recording truncated at byte ", replayCursor);
+				replayCursor = replayData.size();
+				return false;
+			}
+			replayHasPending = true;
+		}
+
+		if (replayPending.frame > _frame) { return false; }
+
+		_record = replayPending;
+		replayHasPending = false;
+		return true;
+	}
+
+	bool InputRecorder::DecodeReplayRecord(input_record& _record) {
+		u64 frame_delta, code, player = 0, value = 0;
+		if (!read_varint(replayData, replayCursor, frame_delta) || replayCursor >= replayData.size()) { return false; }
+
+		u8 flags = replayData[replayCursor++];
+		const bool is_axis = (flags & INPUT_RECORD_FLAG_AXIS) != 0;
+		const bool is_button = (flags & INPUT_RECORD_FLAG_BUTTON) != 0;
+		if (!read_varint(replayData, replayCursor, code)) { return false; }
+		if ((is_button || is_axis) && !read_varint(replayData, replayCursor, player)) { return false; }
+		if (is_axis && !read_varint(replayData, replayCursor, value)) { return false; }
+
+		replayFrame += frame_delta;
+		_record.frame = replayFrame;
+		_record.device = is_axis ? INPUT_RECORD_AXIS : (is_button ? INPUT_RECORD_BUTTON : INPUT_RECORD_KEY);
+		_record.pressed = (flags & INPUT_RECORD_FLAG_PRESSED) != 0;
+		_record.code = (u32)code;
+		_record.player = (u32)player;
+		_record.value = (i32)((u32)(value >> 1) ^ (u32)(-(i64)(value & 1)));
+		return true;
+	}
+}
@@ -0,0 +1,82 @@
+#pragma once
+/* ***********************************************************************************************************
+	DESCRIPTION
+*********************************************************************************************************** */
+/*
+*	Recording of all key/button events with the frame (ProcessEvents() call) they were received in, and replay
+*	of such a recording through the same input queues (no SDL devices needed), for reproducible benchmarks and
+*	regression tests. Records get encoded into a memory buffer and written out in large chunks.
+*
+*	<path>: header { char magic[8] = "BKINP01" }
+*	        followed by records { varint frame_delta, u8 flags (bit 0: button, bit 1: pressed, bit 2: axis), varint code, [varint player], [varint value] }
+*	        frame_delta: frames since the previous record, code: SDL_Keycode, SDL_GameControllerButton or SDL_GameControllerAxis,
+*	        player for buttons and axes, value (zigzag encoded) for axes, varints: LEB128 (7 bits per byte, high bit set -> more bytes follow)
+*	        axis records hold every change of the axis snapshot (deadzones applied), not only the queued axis events
+*/
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <mutex>
+#include <atomic>
+
+#include "defs.h"
+
+namespace Backend {
+	inline const size_t INPUT_RECORD_FLUSH_SIZE = 64 * 1024;
+
+	enum INPUT_RECORD_DEVICE {
+		INPUT_RECORD_KEY = 0,
+		INPUT_RECORD_BUTTON = 1,
+		INPUT_RECORD_AXIS = 2
+	};
+
+	struct input_record {
+		u64 frame = 0;
+		INPUT_RECORD_DEVICE device = INPUT_RECORD_KEY;
+		bool pressed = false;
+		u32 code = 0;
+		u32 player = 0;
+		i32 value = 0;									// axes only
+	};
+
+	class InputRecorder {
+	public:
+		InputRecorder() = default;
+		~InputRecorder();
+
+		// recording, Record() can be called from any producer thread, frames get stored relative to _frame
+		bool StartRecording(const std::string& _path, const u64& _frame);
+		void StopRecording();
+		bool IsRecording() const;
+		void Record(const input_record& _record);
+
+		// replay, consumer is the thread calling ProcessEvents(), the recording starts at _frame
+		bool StartReplay(const std::string& _path, const u64& _frame);
+		void StopReplay();
+		bool IsReplaying() const;
+		bool IsReplayFinished() const;
+		// next record of a frame <= _frame, false if there is none (yet)
+		bool NextReplayRecord(const u64& _frame, input_record& _record);
+
+	private:
+		// recording
+		std::ofstream recordFile;
+		std::vector<u8> recordBuffer;
+		u64 recordStart = 0;
+		u64 recordFrame = 0;							// frame of the last record
+		u64 recordCount = 0;
+		std::mutex mutRecord;
+		alignas(64) std::atomic<bool> recording = false;
+		void FlushRecords();
+
+		// replay
+		std::vector<u8> replayData;
+		size_t replayCursor = 0;
+		u64 replayFrame = 0;
+		input_record replayPending = {};
+		bool replayHasPending = false;
+		alignas(64) std::atomic<bool> replaying = false;
+		bool DecodeReplayRecord(input_record& _record);
+	};
+}
@@ -0,0 +1,300 @@
+#include "pch.h"
+#include "framework.h"
+
+#include "JobSystem.h"
+
+#include "logger.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <format>
+
+#ifdef _WIN32
+#include "windows.h"
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace Backend {
+	// worker threads know their owner and their own deque
+	static thread_local const JobSystem* workerOwner = nullptr;
+	static thread_local int workerIndex = -1;
+
+	JobSystem::~JobSystem() {
+		Stop();
+	}
+
+	/* *************************************************************************************************
+		START / STOP
+	************************************************************************************************* */
+	void JobSystem::Start(const job_settings& _settings) {
+		if (running.load()) { return; }
+
+		int worker_num = _settings.workers;
+		if (worker_num <= 0) {
+			worker_num = std::clamp((int)std::thread::hardware_concurrency() - 1, 1, JOB_WORKERS_DEFAULT_MAX);
+		}
+
+		queues.clear();
+		for (int i = 0; i < worker_num; i++) {
+			queues.emplace_back(std::make_unique<worker_queue>());
+		}
+
+		queuedJobs.store(0);
+		running.store(true);
+		for (int i = 0; i < worker_num; i++) {
+			workers.emplace_back([this, i]() -> void { WorkerThread(i); });
+			if (_settings.pin_cores) {
+				PinThread(workers.back(), _settings.first_core + i);
+			}
+		}
+
+		LOG_INFO("[jobs] ", worker_num, " worker(s) started", _settings.pin_cores ? " (pinned)" : "");
+	}
+
+	void JobSystem::Stop() {
+		if (!running.exchange(false)) { return; }
+
+		{
+			std::unique_lock<std::mutex> lock_workers(mutWorkers);
+			notifyWorkers.notify_all();
+		}
+		for (auto& n : workers) {
+			if (n.joinable()) {
+				n.join();
+			}
+		}
+		workers.clear();
+
+		LOG_INFO("[jobs] workers stopped");
+	}
+
+	int JobSystem::GetWorkerCount() const {
+		return (int)workers.size();
+	}
+
+	/* *************************************************************************************************
+		SUBMIT / WAIT
+	************************************************************************************************* */
+	job_handle JobSystem::Submit(std::function<void()> _task, const job_handle& _parent) {
+		job_handle new_job = std::make_shared<job>();
+		new_job->task = std::move(_task);
+		if (_parent != nullptr) {
+			_parent->unfinished.fetch_add(1);
+			new_job->parent = _parent;
+		}
+
+		Schedule(new_job);
+		return new_job;
+	}
+
+	job_handle JobSystem::Then(const job_handle& _job, std::function<void()> _task) {
+		job_handle continuation = std::make_shared<job>();
+		continuation->task = std::move(_task);
+
+		{
+			std::unique_lock<std::mutex> lock_continuations(_job->mutContinuations);
+			if (!_job->finished) {
+				_job->continuations.emplace_back(continuation);
+				return continuation;
+			}
+		}
+
+		Schedule(continuation);
+		return continuation;
+	}
+
+	void JobSystem::Wait(const job_handle& _job, const bool& _help) {
+		const int index = GetWorkerIndex();
+		while (!IsFinished(_job)) {
+			if (job_handle next = _help ? Pop(index) : PopSubtree(_job); next != nullptr) {
+				Execute(next);
+			} else {
+				// timeout: new jobs don't notify waiting threads
+				std::unique_lock<std::mutex> lock_finished(mutFinished);
+				notifyFinished.wait_for(lock_finished, std::chrono::milliseconds(1), [&_job]() { return _job->unfinished.load() == 0; });
+			}
+		}
+	}
+
+	bool JobSystem::IsFinished(const job_handle& _job) const {
+		return _job == nullptr || _job->unfinished.load() == 0;
+	}
+
+	void JobSystem::ParallelFor(const size_t& _count, const size_t& _chunk_size, const std::function<void(size_t, size_t)>& _task) {
+		if (_count == 0) { return; }
+		const size_t chunk_size = std::max(_chunk_size, (size_t)1);
+
+		// never scheduled itself, only counts the chunks
+		job_handle root = std::make_shared<job>();
+		for (size_t i = 0; i < _count; i += chunk_size) {
+			size_t end = std::min(i + chunk_size, _count);
+			Submit([&_task, i, end]() -> void { _task(i, end); }, root);
+		}
+		Finish(root);
+		Wait(root);
+	}
+
+	/* *************************************************************************************************
+		SCHEDULING
+	************************************************************************************************* */
+	void JobSystem::Schedule(const job_handle& _job) {
+		// not started -> run on the calling thread
+		if (queues.empty() || !running.load()) {
+			Execute(_job);
+			return;
+		}
+
+		int index = GetWorkerIndex();
+		if (index < 0) {
+			index = (int)(nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size());
+		}
+
+		// counted before it's visible -> a worker that pops it never sees a negative count
+		queuedJobs.fetch_add(1);
+		{
+			std::unique_lock<std::mutex> lock_queue(queues[index]->mutQueue);
+			queues[index]->jobs.emplace_back(_job);
+		}
+		{
+			std::unique_lock<std::mutex> lock_workers(mutWorkers);
+			notifyWorkers.notify_one();
+		}
+
+		// Stop() ran meanwhile -> the workers may already be gone, nothing else would drain the queues
+		if (!running.load()) {
+			while (job_handle next = Pop(-1)) {
+				Execute(next);
+			}
+		}
+	}
+
+	// own deque from the back, the others from the front
+	job_handle JobSystem::Pop(const int& _index) {
+		const int queue_num = (int)queues.size();
+
+		if (_index >= 0) {
+			worker_queue& own = *queues[_index];
+			std::unique_lock<std::mutex> lock_queue(own.mutQueue);
+			if (!own.jobs.empty()) {
+				job_handle next = std::move(own.jobs.back());
+				own.jobs.pop_back();
+				queuedJobs.fetch_sub(1);
+				return next;
+			}
+		}
+
+		const int start = _index >= 0 ? _index + 1 : (int)(nextQueue.load(std::memory_order_relaxed) % std::max(queue_num, 1));
+		for (int i = 0; i < queue_num; i++) {
+			int victim = (start + i) % queue_num;
+			if (victim == _index) { continue; }
+
+			worker_queue& other = *queues[victim];
+			std::unique_lock<std::mutex> lock_queue(other.mutQueue);
+			if (!other.jobs.empty()) {
+				job_handle next = std::move(other.jobs.front());
+				other.jobs.pop_front();
+				queuedJobs.fetch_sub(1);
+				return next;
+			}
+		}
+
+		return nullptr;
+	}
+
+	// linear search through all deques, only meant for the rare waits that must not run unrelated jobs
+	job_handle JobSystem::PopSubtree(const job_handle& _root) {
+		auto in_subtree = [&_root](const job_handle& _job) -> bool {
+			for (const job* n = _job.get(); n != nullptr; n = n->parent.get()) {
+				if (n == _root.get()) { return true; }
+			}
+			return false;
+		};
+
+		for (auto& n : queues) {
+			std::unique_lock<std::mutex> lock_queue(n->mutQueue);
+			if (auto it = std::find_if(n->jobs.begin(), n->jobs.end(), in_subtree); it != n->jobs.end()) {
+				job_handle next = std::move(*it);
+				n->jobs.erase(it);
+				queuedJobs.fetch_sub(1);
+				return next;
+			}
+		}
+		return nullptr;
+	}
+
+	void JobSystem::Execute(const job_handle& _job) {
+		if (_job->task) {
+			_job->task();
+		}
+		Finish(_job);
+	}
+
+	void JobSystem::Finish(const job_handle& _job) {
+		if (_job->unfinished.fetch_sub(1) != 1) { return; }
+
+		auto continuations = std::vector<job_handle>();
+		{
+			std::unique_lock<std::mutex> lock_continuations(_job->mutContinuations);
+			_job->finished = true;
+			continuations.swap(_job->continuations);
+		}
+		{
+			std::unique_lock<std::mutex> lock_finished(mutFinished);
+			notifyFinished.notify_all();
+		}
+
+		for (const auto& n : continuations) {
+			Schedule(n);
+		}
+		if (_job->parent != nullptr) {
+			Finish(_job->parent);
+		}
+	}
+
+	/* *************************************************************************************************
+		WORKERS
+	************************************************************************************************* */
+	void JobSystem::WorkerThread(const int& _index) {
+		workerOwner = this;
+		workerIndex = _index;
+		TRACE_THREAD_NAME(std::format("job worker {:d}", _index).c_str());
+
+		while (true) {
+			if (job_handle next = Pop(_index); next != nullptr) {
+				Execute(next);
+				continue;
+			}
+
+			// stop only after the queues ran empty
+			std::unique_lock<std::mutex> lock_workers(mutWorkers);
+			notifyWorkers.wait(lock_workers, [this]() { return queuedJobs.load() > 0 || !running.load(); });
+			if (!running.load() && queuedJobs.load() <= 0) { break; }
+		}
+
+		workerOwner = nullptr;
+		workerIndex = -1;
+	}
+
+	int JobSystem::GetWorkerIndex() const {
+		return workerOwner == this ? workerIndex : -1;
+	}
+
+	void JobSystem::PinThread(std::thread& _thread, const int& _core) {
+		const int core = _core % std::max((int)std::thread::hardware_concurrency(), 1);
+	#ifdef _WIN32
+		if (SetThreadAffinityMask((HANDLE)_thread.native_handle(), (DWORD_PTR)1 << core) == 0) {
+			LOG_WARN("[jobs] pin worker to core ", core);
+		}
+	#else
+		cpu_set_t cpu_set;
+		CPU_ZERO(&cpu_set);
+		CPU_SET(core, &cpu_set);
+		if (pthread_setaffinity_np(_thread.native_handle(), sizeof(cpu_set_t), &cpu_set) != 0) {
+			LOG_WARN("[jobs] pin worker to core ", core);
+		}
+	#endif
+	}
+}
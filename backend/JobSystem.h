@@ -0,0 +1,91 @@
+#pragma once
+/* ***********************************************************************************************************
+	DESCRIPTION
+*********************************************************************************************************** */
+/*
+*	Backend wide work stealing job system owned by the HardwareMgr, subsystems submit jobs instead of spawning
+*	their own threads. Every worker owns a deque: jobs submitted from a worker go to the back of its own deque
+*	and get popped from there again (LIFO, cache warm), idle workers steal from the front of the others.
+*	Jobs submitted from other threads get distributed round robin.
+*	A job finishes after its task and all of its children finished, continuations get scheduled at that point.
+*	Waiting on a job executes other jobs in the meantime, so waiting from inside a job doesn't dead lock.
+*	Waits that must not pick up unrelated work (e.g. startup phases) can be limited to the awaited job's subtree.
+*	The worker count is fixed on start (job_settings), for many instances per host it should be limited there.
+*/
+
+#include <vector>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#include "defs.h"
+#include "HardwareTypes.h"
+
+namespace Backend {
+	inline const int JOB_WORKERS_DEFAULT_MAX = 8;
+
+	struct job {
+		std::function<void()> task;
+		std::shared_ptr<job> parent;
+		std::atomic<int> unfinished = 1;				// the job itself + running children
+
+		std::mutex mutContinuations;
+		std::vector<std::shared_ptr<job>> continuations;
+		bool finished = false;							// guarded by mutContinuations
+	};
+	using job_handle = std::shared_ptr<job>;
+
+	class JobSystem {
+	public:
+		JobSystem() = default;
+		~JobSystem();
+
+		void Start(const job_settings& _settings);
+		void Stop();									// queued jobs get executed first
+		int GetWorkerCount() const;
+
+		// _parent has to be unfinished (e.g. submitted from its own task), it finishes after this job
+		job_handle Submit(std::function<void()> _task, const job_handle& _parent = nullptr);
+		// scheduled once _job and its children finished
+		job_handle Then(const job_handle& _job, std::function<void()> _task);
+		// _help: run any queued job meanwhile, otherwise only queued jobs of _job's subtree (_job itself and its children)
+		void Wait(const job_handle& _job, const bool& _help = true);
+		bool IsFinished(const job_handle& _job) const;
+
+		// splits [0, _count) into chunks of _chunk_size (last one smaller), _task(begin, end) per chunk, returns when all are done
+		void ParallelFor(const size_t& _count, const size_t& _chunk_size, const std::function<void(size_t, size_t)>& _task);
+
+	private:
+		struct worker_queue {
+			std::mutex mutQueue;
+			std::deque<job_handle> jobs;
+		};
+
+		std::vector<std::thread> workers;
+		std::vector<std::unique_ptr<worker_queue>> queues;
+		alignas(64) std::atomic<u32> nextQueue = 0;
+
+		// sleeping workers
+		std::mutex mutWorkers;
+		std::condition_variable notifyWorkers;
+		alignas(64) std::atomic<int> queuedJobs = 0;
+		alignas(64) std::atomic<bool> running = false;
+
+		// threads waiting for a job with nothing left to execute
+		std::mutex mutFinished;
+		std::condition_variable notifyFinished;
+
+		void WorkerThread(const int& _index);
+		void Schedule(const job_handle& _job);
+		job_handle Pop(const int& _index);
+		job_handle PopSubtree(const job_handle& _root);
+		void Execute(const job_handle& _job);
+		void Finish(const job_handle& _job);
+		int GetWorkerIndex() const;
+		static void PinThread(std::thread& _thread, const int& _core);
+	};
+}
@@ -0,0 +1,250 @@
+#include "pch.h"
+#include "framework.h"
+
+#include "VulkanAllocator.h"
+
+#include "logger.h"
+
+#include <format>
+#include <algorithm>
+#include <iterator>
+
+namespace Backend {
+	namespace Graphics {
+		static VkDeviceSize align_up(const VkDeviceSize& _value, const VkDeviceSize& _alignment) {
+			return (_value + _alignment - 1) & ~(_alignment - 1);
+		}
+
+		void VulkanAllocator::Init(VkDevice _device, const VkPhysicalDeviceMemoryProperties& _mem_props, const VkPhysicalDeviceLimits& _limits) {
+			device = _device;
+			memProps = _mem_props;
+			maxAllocationCount = _limits.maxMemoryAllocationCount;
+			blocks.clear();
+			deviceAllocations = 0;
+		}
+
+		void VulkanAllocator::Destroy() {
+			std::unique_lock<std::mutex> lock_allocator(mutAllocator);
+
+			for (auto& n : blocks) {
+				if (n.allocations > 0) {
+					LOG_WARN("[vulkan] allocator: ", n.allocations, " allocation(s) still alive on destroy (memory type ", n.memory_type, ")");
+				}
+				DestroyBlock(n);
+			}
+			blocks.clear();
+		}
+
+		// blocks are sized relative to their heap, small heaps (e.g. 256MB BAR without resizable bar) shouldn't get eaten up by a few blocks
+		VkDeviceSize VulkanAllocator::GetBlockSize(const u32& _memory_type) const {
+			VkDeviceSize heap_size = memProps.memoryHeaps[memProps.memoryTypes[_memory_type].heapIndex].size;
+			VkDeviceSize block_size = ALLOCATOR_BLOCK_SIZE;
+			while (block_size > ALLOCATOR_MIN_BLOCK_SIZE && block_size > heap_size / 8) {
+				block_size /= 2;
+			}
+			return block_size;
+		}
+
+		bool VulkanAllocator::Allocate(const VkMemoryRequirements& _requirements, const u32& _memory_type, const bool& _linear_resource, const ALLOCATION_POOL& _pool, vulkan_allocation& _allocation) {
+			std::unique_lock<std::mutex> lock_allocator(mutAllocator);
+
+			VkDeviceSize alignment = std::max(_requirements.alignment, (VkDeviceSize)1);
+
+			for (u32 i = 0; auto& n : blocks) {
+				if (n.memory != VK_NULL_HANDLE && !n.dedicated && n.memory_type == _memory_type && n.linear_resources == _linear_resource && n.pool == _pool) {
+					if (AllocateFromBlock(n, _requirements.size, alignment, _allocation)) {
+						_allocation.block = i;
+						return true;
+					}
+				}
+				i++;
+			}
+
+			// no space left -> new block, resources larger than half a block get their own allocation
+			VkDeviceSize block_size = GetBlockSize(_memory_type);
+			bool dedicated = _requirements.size > block_size / 2;
+
+			memory_block block = {};
+			block.memory_type = _memory_type;
+			block.linear_resources = _linear_resource;
+			block.dedicated = dedicated;
+			block.pool = _pool;
+			if (!InitBlock(block, dedicated ? _requirements.size : block_size)) {
+				return false;
+			}
+
+			if (!AllocateFromBlock(block, _requirements.size, alignment, _allocation)) {
+				LOG_ERROR("[vulkan] allocator: allocation doesn't fit into new block");
+				DestroyBlock(block);
+				return false;
+			}
+
+			// reuse slots of released blocks, allocations reference their block by index
+			u32 index = 0;
+			for (; index < blocks.size(); index++) {
+				if (blocks[index].memory == VK_NULL_HANDLE) { break; }
+			}
+			if (index < blocks.size()) {
+				blocks[index] = std::move(block);
+			} else {
+				blocks.emplace_back(std::move(block));
+			}
+			_allocation.block = index;
+
+			return true;
+		}
+
+		bool VulkanAllocator::AllocateFromBlock(memory_block& _block, const VkDeviceSize& _size, const VkDeviceSize& _alignment, vulkan_allocation& _allocation) {
+			VkDeviceSize range_offset = 0;
+			VkDeviceSize offset = 0;
+
+			if (_block.pool == POOL_LINEAR) {
+				range_offset = _block.linear_offset;
+				offset = align_up(range_offset, _alignment);
+				if (offset + _size > _block.size) { return false; }
+
+				_block.linear_offset = offset + _size;
+			} else {
+				// first fit
+				auto it = _block.free_ranges.begin();
+				for (; it != _block.free_ranges.end(); it++) {
+					offset = align_up(it->first, _alignment);
+					if (offset + _size <= it->first + it->second) { break; }
+				}
+				if (it == _block.free_ranges.end()) { return false; }
+
+				range_offset = it->first;
+				VkDeviceSize range_end = it->first + it->second;
+				_block.free_ranges.erase(it);
+				if (offset + _size < range_end) {
+					_block.free_ranges[offset + _size] = range_end - (offset + _size);
+				}
+			}
+
+			_allocation.memory = _block.memory;
+			_allocation.offset = offset;
+			_allocation.size = _size;
+			_allocation.mapped = _block.mapped != nullptr ? (u8*)_block.mapped + offset : nullptr;
+			_allocation.range_offset = range_offset;
+			_allocation.range_size = offset + _size - range_offset;
+
+			_block.allocations++;
+			_block.used += _size;
+			_block.wasted += offset - range_offset;
+
+			return true;
+		}
+
+		void VulkanAllocator::Free(vulkan_allocation& _allocation) {
+			if (_allocation.memory == VK_NULL_HANDLE) { return; }
+
+			std::unique_lock<std::mutex> lock_allocator(mutAllocator);
+
+			if (_allocation.block >= blocks.size() || blocks[_allocation.block].memory != _allocation.memory) {
+				LOG_ERROR("[vulkan] allocator: free of unknown allocation");
+				return;
+			}
+			memory_block& block = blocks[_allocation.block];
+
+			block.allocations--;
+			block.used -= _allocation.size;
+			block.wasted -= _allocation.offset - _allocation.range_offset;
+
+			if (block.pool == POOL_LINEAR) {
+				if (block.allocations == 0) {
+					block.linear_offset = 0;
+				}
+			} else {
+				VkDeviceSize offset = _allocation.range_offset;
+				VkDeviceSize size = _allocation.range_size;
+
+				// merge with following and preceding free range
+				if (auto next = block.free_ranges.find(offset + size); next != block.free_ranges.end()) {
+					size += next->second;
+					block.free_ranges.erase(next);
+				}
+				if (auto next = block.free_ranges.lower_bound(offset); next != block.free_ranges.begin()) {
+					auto prev = std::prev(next);
+					if (prev->first + prev->second == offset) {
+						offset = prev->first;
+						size += prev->second;
+						block.free_ranges.erase(prev);
+					}
+				}
+				block.free_ranges[offset] = size;
+			}
+
+			// regular blocks are kept for reuse, dedicated ones are released right away
+			if (block.dedicated && block.allocations == 0) {
+				DestroyBlock(block);
+			}
+
+			_allocation = {};
+		}
+
+		bool VulkanAllocator::InitBlock(memory_block& _block, const VkDeviceSize& _size) {
+			if (maxAllocationCount > 0 && deviceAllocations >= maxAllocationCount) {
+				LOG_ERROR("[vulkan] allocator: maxMemoryAllocationCount (", maxAllocationCount, ") reached");
+				return false;
+			}
+
+			VkMemoryAllocateInfo alloc_info = { VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
+			alloc_info.allocationSize = _size;
+			alloc_info.memoryTypeIndex = _block.memory_type;
+			if (vkAllocateMemory(device, &alloc_info, nullptr, &_block.memory) != VK_SUCCESS) {
+				LOG_ERROR("[vulkan] allocator: allocate memory block (", _size, " bytes, memory type ", _block.memory_type, ")");
+				_block.memory = VK_NULL_HANDLE;
+				return false;
+			}
+			deviceAllocations++;
+
+			_block.size = _size;
+			_block.free_ranges.clear();
+			_block.free_ranges[0] = _size;
+			_block.linear_offset = 0;
+
+			if (memProps.memoryTypes[_block.memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+				if (vkMapMemory(device, _block.memory, 0, VK_WHOLE_SIZE, 0, &_block.mapped) != VK_SUCCESS) {
+					LOG_ERROR("[vulkan] allocator: map memory block");
+					_block.mapped = nullptr;
+				}
+			}
+
+			return true;
+		}
+
+		void VulkanAllocator::DestroyBlock(memory_block& _block) {
+			if (_block.memory == VK_NULL_HANDLE) { return; }
+
+			if (_block.mapped != nullptr) {
+				vkUnmapMemory(device, _block.memory);
+				_block.mapped = nullptr;
+			}
+			vkFreeMemory(device, _block.memory, nullptr);
+			_block.memory = VK_NULL_HANDLE;
+			_block.free_ranges.clear();
+			_block.allocations = 0;
+			_block.used = 0;
+			_block.wasted = 0;
+
+			deviceAllocations--;
+		}
+
+		graphics_memory_stats VulkanAllocator::GetStats() {
+			std::unique_lock<std::mutex> lock_allocator(mutAllocator);
+
+			graphics_memory_stats stats = {};
+			for (const auto& n : blocks) {
+				if (n.memory == VK_NULL_HANDLE) { continue; }
+
+				stats.bytes_reserved += n.size;
+				stats.bytes_used += n.used;
+				stats.bytes_wasted += n.wasted;
+				stats.allocations += n.allocations;
+			}
+			stats.device_allocations = deviceAllocations;
+
+			return stats;
+		}
+	}
+}
\ No newline at end of file
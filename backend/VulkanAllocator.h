@@ -0,0 +1,89 @@
+#pragma once
+/* ***********************************************************************************************************
+	DESCRIPTION
+*********************************************************************************************************** */
+/*
+*	Block sub-allocator for device memory. Instead of calling vkAllocateMemory per buffer/image, memory gets
+*	reserved in large blocks per memory type and handed out in (aligned) ranges. Host visible blocks stay
+*	persistently mapped, allocations from them carry their host address.
+*	Free list pools are used for long living resources, linear pools for transient ones (e.g. staging buffers),
+*	they get reset as soon as the last allocation of a block has been freed.
+*/
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <map>
+#include <mutex>
+
+#include "defs.h"
+#include "HardwareTypes.h"
+
+namespace Backend {
+	namespace Graphics {
+		enum ALLOCATION_POOL {
+			POOL_FREE_LIST,
+			POOL_LINEAR
+		};
+
+		inline const VkDeviceSize ALLOCATOR_BLOCK_SIZE = 32 * 1024 * 1024;
+		inline const VkDeviceSize ALLOCATOR_MIN_BLOCK_SIZE = 1 * 1024 * 1024;
+
+		struct vulkan_allocation {
+			VkDeviceMemory memory = VK_NULL_HANDLE;
+			VkDeviceSize offset = 0;						// aligned offset the resource is bound to
+			VkDeviceSize size = 0;
+			void* mapped = nullptr;							// host address, only for host visible memory
+
+			// range actually taken from the block (includes alignment padding)
+			u32 block = UINT32_MAX;
+			VkDeviceSize range_offset = 0;
+			VkDeviceSize range_size = 0;
+		};
+
+		class VulkanAllocator {
+		public:
+			VulkanAllocator() = default;
+			~VulkanAllocator() = default;
+
+			void Init(VkDevice _device, const VkPhysicalDeviceMemoryProperties& _mem_props, const VkPhysicalDeviceLimits& _limits);
+			void Destroy();
+
+			bool Allocate(const VkMemoryRequirements& _requirements, const u32& _memory_type, const bool& _linear_resource, const ALLOCATION_POOL& _pool, vulkan_allocation& _allocation);
+			void Free(vulkan_allocation& _allocation);
+
+			graphics_memory_stats GetStats();
+
+		private:
+			struct memory_block {
+				VkDeviceMemory memory = VK_NULL_HANDLE;
+				VkDeviceSize size = 0;
+				void* mapped = nullptr;
+
+				u32 memory_type = 0;
+				bool linear_resources = true;				// buffers/linear images and optimal images never share a block (bufferImageGranularity)
+				bool dedicated = false;
+				ALLOCATION_POOL pool = POOL_FREE_LIST;
+
+				std::map<VkDeviceSize, VkDeviceSize> free_ranges;	// offset -> size, adjacent ranges get merged on free
+				VkDeviceSize linear_offset = 0;
+
+				u32 allocations = 0;
+				VkDeviceSize used = 0;
+				VkDeviceSize wasted = 0;
+			};
+
+			VkDevice device = VK_NULL_HANDLE;
+			VkPhysicalDeviceMemoryProperties memProps = {};
+			u32 maxAllocationCount = 0;
+
+			std::vector<memory_block> blocks;
+			u32 deviceAllocations = 0;
+			std::mutex mutAllocator;
+
+			bool AllocateFromBlock(memory_block& _block, const VkDeviceSize& _size, const VkDeviceSize& _alignment, vulkan_allocation& _allocation);
+			bool InitBlock(memory_block& _block, const VkDeviceSize& _size);
+			void DestroyBlock(memory_block& _block);
+			VkDeviceSize GetBlockSize(const u32& _memory_type) const;
+		};
+	}
+}
\ No newline at end of file
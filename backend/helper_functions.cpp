@@ -41,4 +41,16 @@ namespace Helpers {
         size_t end = _in_string.find_last_not_of(WHITESPACE);
         return (end == string::npos) ? "" : _in_string.substr(0, end + 1);
     }
+
+    u64 fnv1a_64(const void* _data, const size_t& _size, const u64& _seed) {
+        const u8* data = (const u8*)_data;
+        u64 hash = _seed;
+
+        for (size_t i = 0; i < _size; i++) {
+            hash ^= data[i];
+            hash *= 0x100000001b3;
+        }
+
+        return hash;
+    }
 }
\ No newline at end of file
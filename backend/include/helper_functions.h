@@ -16,4 +16,7 @@ namespace Helpers {
 	std::string trim(const std::string& _in_string);
 	std::string ltrim(const std::string& _in_string);
 	std::string rtrim(const std::string& _in_string);
+
+	// 64 bit FNV-1a, pass the result of a previous call as _seed to chain multiple buffers into one hash
+	u64 fnv1a_64(const void* _data, const size_t& _size, const u64& _seed = 0xcbf29ce484222325);
 }
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+/* ***********************************************************************************************************
+	DESCRIPTION
+*********************************************************************************************************** */
+/*
+*	GLSL sources for drawing multiple 2d layers with one instanced draw, compiled at runtime with shaderc (results end
+*	up in the shader cache). All layers share one array image (size of the largest layer), instance n samples array
+*	layer n and gets placed by its transform. A single layer uses the precompiled tex2d shaders instead.
+*/
+
+#include "GraphicsMgr.h"
+
+namespace Backend {
+	namespace Graphics {
+		// matches the push constant block of the shaders, has to fit into the guaranteed 128 bytes
+		struct tex2d_layer_push_constants {
+			float transform[TEX2D_LAYERS_MAX][4];	// xy: scale, zw: offset (NDC)
+			float uv_scale[TEX2D_LAYERS_MAX][4];	// xy: layer size / image size
+		};
+		static_assert(sizeof(tex2d_layer_push_constants) <= 128);
+		static_assert(TEX2D_LAYERS_MAX == 4, "LAYERS_MAX of the vertex shader has to match");
+
+		inline const char TEX2D_LAYERS_VERT_NAME[] = "tex2d_layers.vert";
+		inline const char TEX2D_LAYERS_VERT_SOURCE[] = R"(
+#version 450
+#define LAYERS_MAX 4
+
+layout(location = 0) in vec2 in_pos;
+layout(location = 1) in vec2 in_uv;
+
+layout(location = 0) out vec3 out_uv;
+
+layout(push_constant) uniform layer_params {
+	vec4 transform[LAYERS_MAX];
+	vec4 uv_scale[LAYERS_MAX];
+} params;
+
+void main() {
+	vec4 t = params.transform[gl_InstanceIndex];
+	gl_Position = vec4(in_pos * t.xy + t.zw, 0., 1.);
+	out_uv = vec3(in_uv * params.uv_scale[gl_InstanceIndex].xy, float(gl_InstanceIndex));
+}
+)";
+
+		inline const char TEX2D_LAYERS_FRAG_NAME[] = "tex2d_layers.frag";
+		inline const char TEX2D_LAYERS_FRAG_SOURCE[] = R"(
+#version 450
+
+layout(set = 0, binding = 0) uniform sampler2DArray layers;
+
+layout(location = 0) in vec3 in_uv;
+
+layout(location = 0) out vec4 out_color;
+
+void main() {
+	out_color = texture(layers, in_uv);
+}
+)";
+	}
+}
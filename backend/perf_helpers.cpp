@@ -0,0 +1,153 @@
+#include "pch.h"
+#include "framework.h"
+
+#include "perf_helpers.h"
+
+#include <algorithm>
+#include <thread>
+#include <cmath>
+
+using namespace std::chrono;
+
+namespace Backend {
+	void rolling_stats::add(const float& _value) {
+		samples[cursor] = _value;
+		++cursor %= samples.size();
+		if (count < samples.size()) { count++; }
+		last = _value;
+	}
+
+	perf_stats rolling_stats::get() const {
+		perf_stats stats = {};
+		if (count == 0) { return stats; }
+
+		// per thread scratch buffer, only grows (assign() keeps the capacity)
+		static thread_local std::vector<float> sorted;
+		sorted.assign(samples.begin(), samples.begin() + count);
+
+		float sum = 0.f;
+		stats.min = sorted.front();
+		stats.max = sorted.front();
+		for (const auto& n : sorted) {
+			sum += n;
+			stats.min = std::min(stats.min, n);
+			stats.max = std::max(stats.max, n);
+		}
+
+		// ascending ranks -> every partition only has to look at the part above the previous rank
+		size_t from = 0;
+		auto percentile = [&from](const float& _p) -> float {
+			size_t rank = std::max(from, std::min(sorted.size() - 1, (size_t)(sorted.size() * _p)));
+			std::nth_element(sorted.begin() + from, sorted.begin() + rank, sorted.end());
+			from = rank;
+			return sorted[rank];
+		};
+		stats.p50 = percentile(.5f);
+		stats.p95 = percentile(.95f);
+		stats.p99 = percentile(.99f);
+
+		stats.avg = sum / count;
+		stats.last = last;
+		stats.samples = (u32)count;
+		return stats;
+	}
+
+	void rolling_stats::reset() {
+		cursor = 0;
+		count = 0;
+		last = 0.f;
+	}
+
+	size_t rolling_stats::size() const {
+		return count;
+	}
+
+	float rolling_stats::at(const size_t& _index) const {
+		// not wrapped yet -> oldest sample at 0, otherwise at the cursor
+		size_t oldest = count < samples.size() ? 0 : cursor;
+		return samples[(oldest + _index) % samples.size()];
+	}
+
+	void rolling_stats::histogram(float* _bins, const int& _bin_num, const float& _min, const float& _max) const {
+		if (_bin_num <= 0) { return; }
+		std::fill(_bins, _bins + _bin_num, 0.f);
+		if (_max <= _min) { return; }
+
+		const float scale = _bin_num / (_max - _min);
+		for (size_t i = 0; i < count; i++) {
+			int bin = (int)((samples[i] - _min) * scale);
+			_bins[std::clamp(bin, 0, _bin_num - 1)] += 1.f;
+		}
+	}
+
+	inline const nanoseconds MIN_SPIN_TIME = microseconds(200);
+	inline const nanoseconds MAX_SPIN_TIME = milliseconds(4);
+
+	void frame_pacer::set_rate(const double& _fps) {
+		periodNs = _fps > 0 ? (1e9 / _fps) : .0;
+		reset();
+	}
+
+	double frame_pacer::get_rate() const {
+		return periodNs > 0 ? (1e9 / periodNs) : .0;
+	}
+
+	void frame_pacer::reset() {
+		start = steady_clock::now();
+		last = start;
+		frame = 0;
+		frameTimes.reset();
+		jitter.reset();
+	}
+
+	void frame_pacer::wait() {
+		steady_clock::time_point now = steady_clock::now();
+
+		if (periodNs > 0) {
+			frame++;
+			steady_clock::time_point deadline = start + nanoseconds((i64)std::llround(frame * periodNs));
+
+			// fell behind more than a frame (e.g. window dragged, breakpoint) -> restart the schedule instead of rushing frames
+			if (now - deadline > nanoseconds((i64)periodNs)) {
+				start = now;
+				frame = 0;
+				deadline = now;
+			}
+
+			// coarse sleep, keep a margin for the sleep overshoot
+			nanoseconds spin_time = std::clamp(sleepOvershoot, MIN_SPIN_TIME, MAX_SPIN_TIME);
+			if (deadline - now > spin_time) {
+				nanoseconds sleep_time = duration_cast<nanoseconds>(deadline - now - spin_time);
+				std::this_thread::sleep_for(sleep_time);
+
+				steady_clock::time_point woke = steady_clock::now();
+				nanoseconds overshoot = duration_cast<nanoseconds>(woke - now) - sleep_time;
+				sleepOvershoot = overshoot > sleepOvershoot ? overshoot : (sleepOvershoot * 63 + overshoot) / 64;
+				now = woke;
+			}
+
+			// remaining sub-millisecond part
+			while (now < deadline) {
+				std::this_thread::yield();
+				now = steady_clock::now();
+			}
+
+			jitter.add(duration_cast<nanoseconds>(now - deadline).count() / 1e6f);
+		}
+
+		frameTimes.add(duration_cast<nanoseconds>(now - last).count() / 1e6f);
+		last = now;
+	}
+
+	perf_stats frame_pacer::get_frame_times() const {
+		return frameTimes.get();
+	}
+
+	perf_stats frame_pacer::get_jitter() const {
+		return jitter.get();
+	}
+
+	const rolling_stats& frame_pacer::get_frame_time_window() const {
+		return frameTimes;
+	}
+}
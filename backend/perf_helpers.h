@@ -0,0 +1,74 @@
+#pragma once
+/* ***********************************************************************************************************
+	DESCRIPTION
+*********************************************************************************************************** */
+/*
+*	Helpers for collecting timings (frame times, GPU pass times, etc.) over a fixed window of recent samples
+*	and for pacing frames to a target rate
+*/
+
+#include <vector>
+#include <mutex>
+#include <chrono>
+
+#include "defs.h"
+#include "HardwareTypes.h"
+
+namespace Backend {
+	/* *************************************************************************************************
+		ROLLING WINDOW OVER THE LAST N SAMPLES, MIN/AVG/PERCENTILES ARE CALCULATED ON REQUEST,
+		THE WINDOW GETS ALLOCATED ONCE (NOTHING ALLOCATES PER SAMPLE OR PER QUERY AFTER THE FIRST ONE)
+	************************************************************************************************* */
+	struct rolling_stats {
+	public:
+		explicit rolling_stats(const size_t& _window = 128) : samples(_window, 0.f) {}
+
+		void add(const float& _value);
+		perf_stats get() const;
+		void reset();
+
+		// oldest -> newest, e.g. for ImGui::PlotLines
+		size_t size() const;
+		float at(const size_t& _index) const;
+
+		// sample count per bin over [_min, _max), values outside land in the first/last bin
+		void histogram(float* _bins, const int& _bin_num, const float& _min, const float& _max) const;
+
+	private:
+		std::vector<float> samples;
+		size_t cursor = 0;
+		size_t count = 0;
+		float last = 0.f;
+	};
+
+	/* *************************************************************************************************
+		FRAME PACER: ABSOLUTE DEADLINES (START + N * PERIOD) SO ROUNDING ERRORS DON'T ADD UP OVER TIME,
+		SLEEPS COARSELY AND YIELDS FOR THE REMAINDER (SLEEP OVERSHOOT OF THE OS GETS MEASURED)
+	************************************************************************************************* */
+	class frame_pacer {
+	public:
+		frame_pacer() = default;
+		~frame_pacer() = default;
+
+		void set_rate(const double& _fps);			// <= 0 -> unlimited
+		double get_rate() const;
+		void wait();
+		void reset();
+
+		perf_stats get_frame_times() const;			// ms between two wait() returns
+		perf_stats get_jitter() const;				// ms the deadline was missed by
+		const rolling_stats& get_frame_time_window() const;
+
+	private:
+		double periodNs = .0;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		std::chrono::steady_clock::time_point last = std::chrono::steady_clock::now();
+		u64 frame = 0;
+
+		// estimate of how much sleep_for() oversleeps, decays slowly towards better values
+		std::chrono::nanoseconds sleepOvershoot = std::chrono::microseconds(1000);
+
+		rolling_stats frameTimes = rolling_stats(256);
+		rolling_stats jitter = rolling_stats(256);
+	};
+}
@@ -0,0 +1,185 @@
+#include "pch.h"
+#include "framework.h"
+
+#include "trace.h"
+
+#include "logger.h"
+
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <fstream>
+#include <format>
+
+namespace Backend {
+	namespace Trace {
+		std::atomic<bool> traceEnabled = false;
+
+		// seqlock per slot (written by the owning thread only): odd while being written, 2 * index + 2 once event index is complete
+		struct trace_event {
+			std::atomic<u64> sequence = 0;
+			std::atomic<const char*> name = nullptr;
+			std::atomic<u64> start_ns = 0;
+			std::atomic<u64> end_ns = 0;
+		};
+
+		// events [max(0, written - size), written) are valid, the ring gets allocated with the first event
+		// (named threads that never record while tracing is enabled stay small)
+		struct thread_buffer {
+			std::unique_ptr<trace_event[]> storage;
+			std::atomic<trace_event*> events = nullptr;
+			alignas(64) std::atomic<u64> written = 0;
+			std::string name;
+			u32 tid = 0;
+		};
+
+		// buffers outlive their threads, the events stay available for the dump
+		static std::mutex mutBuffers;
+		static std::vector<std::shared_ptr<thread_buffer>> buffers;
+		static thread_local thread_buffer* threadBuffer = nullptr;
+
+		// registration is the only locked path, happens once per thread
+		static thread_buffer* get_thread_buffer() {
+			if (threadBuffer == nullptr) {
+				auto buffer = std::make_shared<thread_buffer>();
+				std::unique_lock<std::mutex> lock_buffers(mutBuffers);
+				buffer->tid = (u32)buffers.size() + 1;
+				buffer->name = std::format("thread {:d}", buffer->tid);
+				buffers.emplace_back(buffer);
+				threadBuffer = buffer.get();
+			}
+			return threadBuffer;
+		}
+
+		void record(const char* _name, const u64& _start_ns, const u64& _end_ns) {
+			thread_buffer* buffer = get_thread_buffer();
+			trace_event* events = buffer->events.load(std::memory_order_relaxed);
+			if (events == nullptr) {
+				buffer->storage = std::make_unique<trace_event[]>(TRACE_EVENTS_PER_THREAD);
+				events = buffer->storage.get();
+				buffer->events.store(events, std::memory_order_release);
+			}
+
+			u64 index = buffer->written.load(std::memory_order_relaxed);
+			trace_event& event = events[index % TRACE_EVENTS_PER_THREAD];
+			event.sequence.store(2 * index + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			event.name.store(_name, std::memory_order_relaxed);
+			event.start_ns.store(_start_ns, std::memory_order_relaxed);
+			event.end_ns.store(_end_ns, std::memory_order_relaxed);
+			event.sequence.store(2 * index + 2, std::memory_order_release);
+			buffer->written.store(index + 1, std::memory_order_release);
+		}
+
+		// false if the slot doesn't (or no longer) hold event _index
+		static bool read_event(const trace_event* _events, const u64& _index, const char*& _name, u64& _start_ns, u64& _end_ns) {
+			const trace_event& event = _events[_index % TRACE_EVENTS_PER_THREAD];
+			u64 sequence = event.sequence.load(std::memory_order_acquire);
+			if (sequence != 2 * _index + 2) { return false; }
+
+			_name = event.name.load(std::memory_order_relaxed);
+			_start_ns = event.start_ns.load(std::memory_order_relaxed);
+			_end_ns = event.end_ns.load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			return event.sequence.load(std::memory_order_relaxed) == sequence;
+		}
+
+		void set_thread_name(const char* _name) {
+			thread_buffer* buffer = get_thread_buffer();
+			std::unique_lock<std::mutex> lock_buffers(mutBuffers);
+			buffer->name = _name;
+		}
+
+		void set_enabled(const bool& _enable) {
+			traceEnabled.store(_enable);
+			LOG_INFO("[trace] ", _enable ? "enabled" : "disabled");
+		}
+
+		bool is_enabled() {
+			return traceEnabled.load();
+		}
+
+		static void write_escaped(std::ofstream& _file, const std::string& _text) {
+			for (const char& c : _text) {
+				if (c == '"' || c == '\\') { _file.put('\\'); }
+				_file.put(c);
+			}
+		}
+
+		// complete events ("X") with microsecond timestamps, thread names as metadata events
+		bool dump(const std::string& _path) {
+			std::ofstream file = std::ofstream(_path, std::ios::trunc);
+			if (!file.is_open()) {
+				LOG_ERROR("[trace] open ", _path);
+				return false;
+			}
+
+			std::unique_lock<std::mutex> lock_buffers(mutBuffers);
+
+			// zones get recorded when they end -> the earliest start can be anywhere in the ring
+			u64 base_ns = UINT64_MAX;
+			for (const auto& n : buffers) {
+				const trace_event* events = n->events.load(std::memory_order_acquire);
+				if (events == nullptr) { continue; }
+				u64 written = n->written.load(std::memory_order_acquire);
+				u64 begin = written > TRACE_EVENTS_PER_THREAD ? written - TRACE_EVENTS_PER_THREAD : 0;
+				for (u64 i = begin; i < written; i++) {
+					const char* name;
+					u64 start_ns, end_ns;
+					if (read_event(events, i, name, start_ns, end_ns)) {
+						base_ns = std::min(base_ns, start_ns);
+					}
+				}
+			}
+
+			size_t event_num = 0;
+			bool first = true;
+			file << "{\"traceEvents\":[\n";
+			for (const auto& n : buffers) {
+				if (!first) { file << ",\n"; }
+				first = false;
+				file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << n->tid << ",\"args\":{\"name\":\"";
+				write_escaped(file, n->name);
+				file << "\"}}";
+
+				const trace_event* events = n->events.load(std::memory_order_acquire);
+				if (events == nullptr) { continue; }
+				u64 written = n->written.load(std::memory_order_acquire);
+				u64 begin = written > TRACE_EVENTS_PER_THREAD ? written - TRACE_EVENTS_PER_THREAD : 0;
+				for (u64 i = begin; i < written; i++) {
+					const char* name;
+					u64 start_ns, end_ns;
+					// overwritten during the dump
+					if (!read_event(events, i, name, start_ns, end_ns) || name == nullptr || start_ns < base_ns || end_ns < start_ns) { continue; }
+
+					file << std::format(",\n{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":1,\"tid\":{:d},\"ts\":{:.3f},\"dur\":{:.3f}}}",
+						name, n->tid, (start_ns - base_ns) / 1000.0, (end_ns - start_ns) / 1000.0);
+					event_num++;
+				}
+			}
+			file << "\n],\"displayTimeUnit\":\"ns\"}\n";
+
+			if (!file.good()) {
+				LOG_ERROR("[trace] write ", _path);
+				return false;
+			}
+
+			LOG_INFO("[trace] ", event_num, " event(s) of ", buffers.size(), " thread(s) written to ", _path);
+			return true;
+		}
+
+		// only safe while tracing is disabled
+		void clear() {
+			std::unique_lock<std::mutex> lock_buffers(mutBuffers);
+			for (auto& n : buffers) {
+				n->written.store(0);
+				if (trace_event* events = n->events.load(); events != nullptr) {
+					for (size_t i = 0; i < TRACE_EVENTS_PER_THREAD; i++) {
+						events[i].sequence.store(0, std::memory_order_relaxed);
+					}
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+/* ***********************************************************************************************************
+	DESCRIPTION
+*********************************************************************************************************** */
+/*
+*	Scoped trace zones for correlating stalls across threads (main loop, render/submit, audio, jobs).
+*	Every thread records into its own ring of events (only written by that thread, every slot published with a
+*	seqlock), the rings get dumped on request as Chrome trace JSON (chrome://tracing, ui.perfetto.dev).
+*	A ring only gets allocated with the first event of its thread, naming a thread doesn't allocate it.
+*	While tracing is disabled a zone costs one relaxed atomic load, defining TRACING_DISABLE removes them completely.
+*	Zone names have to be string literals (only the pointer gets stored).
+*/
+
+#include <string>
+#include <atomic>
+#include <chrono>
+
+#include "defs.h"
+
+//#define TRACING_DISABLE
+
+#define TRACE_CONCAT_INNER(_a, _b) _a##_b
+#define TRACE_CONCAT(_a, _b) TRACE_CONCAT_INNER(_a, _b)
+
+#ifdef TRACING_DISABLE
+#define TRACE_ZONE(_name)
+#define TRACE_THREAD_NAME(_name)
+#else
+#define TRACE_ZONE(_name) Backend::Trace::trace_zone TRACE_CONCAT(trace_zone_, __LINE__)(_name)
+#define TRACE_THREAD_NAME(_name) Backend::Trace::set_thread_name(_name)
+#endif
+
+namespace Backend {
+	namespace Trace {
+		inline const size_t TRACE_EVENTS_PER_THREAD = 1 << 16;			// ring size, oldest events get overwritten
+
+		extern std::atomic<bool> traceEnabled;
+
+		inline u64 now_ns() {
+			return (u64)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+
+		void record(const char* _name, const u64& _start_ns, const u64& _end_ns);
+		void set_thread_name(const char* _name);
+
+		void set_enabled(const bool& _enable);
+		bool is_enabled();
+
+		// all rings -> Chrome trace JSON, can be called while tracing (events recorded meanwhile may be missing)
+		bool dump(const std::string& _path);
+		void clear();
+
+		struct trace_zone {
+			explicit trace_zone(const char* _name) : name(_name) {
+				if (traceEnabled.load(std::memory_order_relaxed)) {
+					start = now_ns();
+				}
+			}
+			~trace_zone() {
+				if (start != 0) {
+					record(name, start, now_ns());
+				}
+			}
+
+			trace_zone(const trace_zone&) = delete;
+			trace_zone& operator=(const trace_zone&) = delete;
+
+		private:
+			const char* name;
+			u64 start = 0;
+		};
+	}
+}
@@ -0,0 +1,155 @@
+#pragma once
+/* ***********************************************************************************************************
+	DESCRIPTION
+*********************************************************************************************************** */
+/*
+*	GLSL sources of the compute upscale passes, compiled at runtime with shaderc (results end up in the shader cache).
+*	Every pass reads the previous image (binding 0) and writes the next one (binding 1), one invocation per output texel.
+*/
+
+#include "HardwareTypes.h"
+
+namespace Backend {
+	namespace Graphics {
+		struct upscale_shader {
+			const char* name;						// file name for shaderc/the shader cache, extension selects the stage
+			const char* source;						// without UPSCALE_SHADER_HEADER
+		};
+
+		// prepended to every pass
+		inline const char UPSCALE_SHADER_HEADER[] = R"(
+#version 450
+layout(local_size_x = 8, local_size_y = 8) in;
+
+layout(set = 0, binding = 0) uniform sampler2D src_image;
+layout(set = 0, binding = 1, rgba8) uniform writeonly image2D dst_image;
+
+layout(push_constant) uniform upscale_params {
+	ivec2 src_size;
+	ivec2 dst_size;
+	float strength;
+} params;
+
+vec3 fetch(ivec2 _pos) {
+	return texelFetch(src_image, clamp(_pos, ivec2(0), params.src_size - 1), 0).rgb;
+}
+
+// texel centre of the output texel in source texel coordinates
+vec2 src_pos(ivec2 _dst) {
+	return (vec2(_dst) + .5) * vec2(params.src_size) / vec2(params.dst_size);
+}
+)";
+
+		inline const char UPSCALE_INTEGER_SOURCE[] = R"(
+void main() {
+	ivec2 dst = ivec2(gl_GlobalInvocationID.xy);
+	if (any(greaterThanEqual(dst, params.dst_size))) { return; }
+
+	imageStore(dst_image, dst, vec4(fetch(ivec2(floor(src_pos(dst)))), 1.));
+}
+)";
+
+		// sampled with a linear sampler: bilinear only across the texel edges, the width of the blended region is one output texel
+		inline const char UPSCALE_SHARP_BILINEAR_SOURCE[] = R"(
+void main() {
+	ivec2 dst = ivec2(gl_GlobalInvocationID.xy);
+	if (any(greaterThanEqual(dst, params.dst_size))) { return; }
+
+	vec2 scale = vec2(params.dst_size) / vec2(params.src_size);
+	vec2 pos = src_pos(dst);
+	vec2 centre_dist = fract(pos) - .5;
+	vec2 region = .5 - .5 / scale;
+	vec2 f = (centre_dist - clamp(centre_dist, -region, region)) * scale + .5;
+	vec2 uv = (floor(pos) + f) / vec2(params.src_size);
+
+	imageStore(dst_image, dst, vec4(textureLod(src_image, uv, 0.).rgb, 1.));
+}
+)";
+
+		// xBR level 1: the corner of E the output texel lies in gets replaced by F or H if an edge runs along H-F
+		//    A1 B1 C1
+		// A0 A  B  C  C4
+		// D0 D  E  F  F4
+		// G0 G  H  I  I4
+		//    G5 H5 I5
+		inline const char UPSCALE_XBR_SOURCE[] = R"(
+float df(vec3 _a, vec3 _b) {
+	vec3 d = _a - _b;
+	float y = dot(d, vec3(.299, .587, .114));
+	float u = dot(d, vec3(-.169, -.331, .5));
+	float v = dot(d, vec3(.5, -.419, -.081));
+	return 48. * abs(y) + 7. * abs(u) + 6. * abs(v);
+}
+
+void main() {
+	ivec2 dst = ivec2(gl_GlobalInvocationID.xy);
+	if (any(greaterThanEqual(dst, params.dst_size))) { return; }
+
+	vec2 pos = src_pos(dst);
+	ivec2 p = ivec2(floor(pos));
+	vec2 c = fract(pos) - .5;
+
+	vec3 E = fetch(p);
+	vec3 color = E;
+
+	// corner is cut off by the line x + y = 1.5 (texel space rotated towards the corner)
+	if (abs(c.x) + abs(c.y) > .5) {
+		ivec2 ax = ivec2(c.x < 0. ? -1 : 1, 0);
+		ivec2 ay = ivec2(0, c.y < 0. ? -1 : 1);
+
+		vec3 B = fetch(p - ay);
+		vec3 C = fetch(p + ax - ay);
+		vec3 D = fetch(p - ax);
+		vec3 F = fetch(p + ax);
+		vec3 G = fetch(p - ax + ay);
+		vec3 H = fetch(p + ay);
+		vec3 I = fetch(p + ax + ay);
+		vec3 F4 = fetch(p + 2 * ax);
+		vec3 I4 = fetch(p + 2 * ax + ay);
+		vec3 H5 = fetch(p + 2 * ay);
+		vec3 I5 = fetch(p + ax + 2 * ay);
+
+		float wd_edge = df(E, C) + df(E, G) + df(I, H5) + df(I, F4) + 4. * df(H, F);
+		float wd_cross = df(H, D) + df(H, I5) + df(F, I4) + df(F, B) + 4. * df(E, I);
+
+		float e_f = df(E, F);
+		float e_h = df(E, H);
+		if (wd_edge < wd_cross && e_f > 0. && e_h > 0.) {
+			color = e_f <= e_h ? F : H;
+		}
+	}
+
+	imageStore(dst_image, dst, vec4(color, 1.));
+}
+)";
+
+		// horizontal beam blending, gaussian scanlines and an aperture grille mask, done in linear light
+		inline const char UPSCALE_CRT_SOURCE[] = R"(
+void main() {
+	ivec2 dst = ivec2(gl_GlobalInvocationID.xy);
+	if (any(greaterThanEqual(dst, params.dst_size))) { return; }
+
+	vec2 pos = src_pos(dst);
+	float x = pos.x - .5;
+	ivec2 p = ivec2(int(floor(x)), int(floor(pos.y)));
+	vec3 color = mix(pow(fetch(p), vec3(2.2)), pow(fetch(p + ivec2(1, 0)), vec3(2.2)), fract(x));
+
+	float dy = fract(pos.y) - .5;
+	float beam = exp(-dy * dy * 12. * params.strength);
+
+	vec3 mask = vec3(1. - .35 * params.strength);
+	mask[dst.x % 3] = 1.;
+
+	color *= beam * mask * (1. + .4 * params.strength);
+	imageStore(dst_image, dst, vec4(pow(clamp(color, 0., 1.), vec3(1. / 2.2)), 1.));
+}
+)";
+
+		inline const upscale_shader UPSCALE_SHADERS[UPSCALE_FILTER_NUM] = {
+			{ "upscale_integer.comp", UPSCALE_INTEGER_SOURCE },
+			{ "upscale_sharp_bilinear.comp", UPSCALE_SHARP_BILINEAR_SOURCE },
+			{ "upscale_xbr.comp", UPSCALE_XBR_SOURCE },
+			{ "upscale_crt.comp", UPSCALE_CRT_SOURCE }
+		};
+	}
+}